@@ -21,9 +21,9 @@ torch::Tensor ResizeTransform::apply_image(torch::Tensor img, Interp interp) {
 	}
 
 	if (img.dtype() == torch::kUInt8) {
-		cv::Mat mimg = image_to_mat(img);
-		cv::resize(mimg, mimg, { m_new_w, m_new_h }, 0.0, 0.0, interp);
-		img = image_to_tensor(mimg);
+		cv::Mat resized;
+		cv::resize(image_to_mat(img), resized, { m_new_w, m_new_h }, 0.0, 0.0, interp);
+		img = mat_to_tensor(resized);
 	}
 	else {
 		auto shape = torch::tensor(img.sizes());
@@ -19,6 +19,10 @@ namespace Detectron2
 		*/
 		ResizeTransform(int h, int w, int new_h, int new_w, Interp interp = kBILINEAR);
 
+		int new_h() const { return m_new_h; }
+		int new_w() const { return m_new_w; }
+		Interp interp() const { return m_interp; }
+
 		virtual torch::Tensor apply_image(torch::Tensor img, Interp interp = kNone) override;
 		virtual torch::Tensor apply_coords(torch::Tensor coords) override;
 		virtual torch::Tensor apply_segmentation(torch::Tensor segmentation) override;
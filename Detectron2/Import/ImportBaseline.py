@@ -2,14 +2,73 @@
 import os
 import pickle
 import re
+import struct
 import sys
+import zlib
 from numpy import array
 
 # Example: python ImportBaseline.py model_final_997cc7
+#          python ImportBaseline.py model_final_997cc7 --d2w
+#
+# The first form writes model_final_997cc7.data plus generated Baseline\model_final_997cc7.cpp.
+# The second form writes a self-describing model_final_997cc7.d2w that ModelImporter reads at runtime
+# without recompiling. See ModelImporter.h for its layout.
 modelName = sys.argv[1]
+d2w = '--d2w' in sys.argv[2:]
 
 checkpoints = os.getenv('D2_CHECKPOINTS_DIR') + '\\'
 
+
+def align(offset, alignment):
+    return (offset + alignment - 1) // alignment * alignment
+
+
+def write_d2w(model, filename, alignment=4096):
+    dtypes = {
+        numpy.dtype('float32'): 0,
+        numpy.dtype('float64'): 1,
+        numpy.dtype('float16'): 2,
+        numpy.dtype('int64'): 3,
+        numpy.dtype('int32'): 4,
+        numpy.dtype('uint8'): 5,
+    }
+    tensors = []
+    for key in model:
+        data = numpy.ascontiguousarray(model[key])
+        assert data.dtype in dtypes, "{}: unsupported dtype {}".format(key, data.dtype)
+        tensors.append((key, data))
+
+    # index size doesn't depend on offsets, so it can be computed first
+    index_size = 0
+    for key, data in tensors:
+        index_size += 2 + len(key.encode('utf-8')) + 1 + 1 + 8 * data.ndim + 8 + 8 + 4
+    data_offset = align(4 + 4 + 4 + 4 + 8 + index_size, alignment)
+
+    index = b''
+    offsets = []
+    offset = data_offset
+    for key, data in tensors:
+        name = key.encode('utf-8')
+        index += struct.pack('<H', len(name)) + name
+        index += struct.pack('<BB', dtypes[data.dtype], data.ndim)
+        index += struct.pack('<' + 'q' * data.ndim, *data.shape)
+        index += struct.pack('<QQI', offset, data.nbytes, zlib.crc32(data.tobytes()) & 0xffffffff)
+        offsets.append(offset)
+        offset = align(offset + data.nbytes, alignment)
+
+    with open(filename, 'wb') as f:
+        f.write(b'D2WF' + struct.pack('<IIIQ', 1, len(tensors), alignment, data_offset))
+        f.write(index)
+        for (key, data), offset in zip(tensors, offsets):
+            f.write(b'\0' * (offset - f.tell()))
+            f.write(data.tobytes())
+
+
+if d2w:
+    loaded = pickle.load(open(checkpoints + modelName + '.pkl', 'rb'))
+    write_d2w(loaded["model"], checkpoints + modelName + '.d2w')
+    sys.exit(0)
+
 fcpp = open(os.getcwd() + '\\Baseline\\' + modelName + '.cpp', 'w')
 fdataFileName = checkpoints + modelName + '.data'
 fdata = open(fdataFileName, 'wb')
@@ -2,6 +2,9 @@
 #include "ModelImporter.h"
 
 #include <Detectron2/Modules/BatchNorm/BatchNorm.h>
+#include <Detectron2/Utils/Utils.h>
+
+#include <cstring>
 
 using namespace std;
 using namespace torch;
@@ -25,6 +28,27 @@ void ModelImporter::FillTensor(Tensor x, ModelImporter::Fill fill) {
 	}
 }
 
+// same as python's zlib.crc32()
+static uint32_t crc32(const char *data, int64_t len) {
+	static const auto s_table = []() {
+		std::array<uint32_t, 256> table;
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+			}
+			table[i] = c;
+		}
+		return table;
+	}();
+
+	uint32_t crc = 0xFFFFFFFFu;
+	for (int64_t i = 0; i < len; i++) {
+		crc = s_table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
 ModelImporter::Model ModelImporter::FilenameToModel(const std::string &filename) {
 	static unordered_map<string, Model> s_models = {
 		{ "model_final_f10217.pkl", kDemo },
@@ -40,10 +64,21 @@ ModelImporter::Model ModelImporter::FilenameToModel(const std::string &filename)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-ModelImporter::ModelImporter(const std::string &filename) : ModelImporter(FilenameToModel(filename)) {
+ModelImporter::ModelImporter(const std::string &filename) : m_size(0) {
+	auto d2w = File::ComposeFilename(DataDir(), File::ReplaceExtension(filename, "d2w"));
+	if (File::IsFile(d2w)) {
+		OpenD2W(d2w);
+	}
+	else {
+		Open(FilenameToModel(filename));
+	}
+}
+
+ModelImporter::ModelImporter(Model model) : m_size(0) {
+	Open(model);
 }
 
-ModelImporter::ModelImporter(Model model) {
+void ModelImporter::Open(Model model) {
 	std::string fullpath;
 	switch (model) {
 	case kDemo:							fullpath = import_model_final_f10217(); break;
@@ -54,7 +89,7 @@ ModelImporter::ModelImporter(Model model) {
 	}
 	if (!fullpath.empty()) {
 		m_fullpath = fullpath;
-		m_fdata = make_shared<File>(fullpath, true);
+		m_fdata = make_shared<MappedFile>(fullpath);
 	}
 }
 
@@ -64,8 +99,79 @@ std::string ModelImporter::DataDir() {
 	return dir;
 }
 
-void ModelImporter::Add(const char *name, int count) {
-	m_sections[name] = { m_size, count };
+void ModelImporter::OpenD2W(const std::string &fullpath) {
+	m_fullpath = fullpath;
+	m_fdata = make_shared<MappedFile>(fullpath);
+
+	const char *data = m_fdata->data();
+	int64_t size = m_fdata->size();
+	int64_t pos = 0;
+	auto read = [&](void *dest, int64_t len) {
+		verify(pos + len <= size); // truncated .d2w header
+		memcpy(dest, data + pos, len);
+		pos += len;
+	};
+
+	char magic[4];
+	uint32_t version, tensor_count, alignment;
+	uint64_t data_offset;
+	read(magic, 4);
+	verify(memcmp(magic, "D2WF", 4) == 0);
+	read(&version, 4);
+	verify(version <= kD2WVersion);
+	read(&tensor_count, 4);
+	read(&alignment, 4);
+	read(&data_offset, 8);
+	verify((int64_t)data_offset <= size);
+
+	for (uint32_t i = 0; i < tensor_count; i++) {
+		uint16_t name_len;
+		read(&name_len, 2);
+		string name(name_len, '\0');
+		read(&name[0], name_len);
+
+		uint8_t dtype, ndim;
+		read(&dtype, 1);
+		read(&ndim, 1);
+
+		Section section;
+		section.shape.resize(ndim);
+		section.count = 1;
+		for (int d = 0; d < ndim; d++) {
+			read(&section.shape[d], 8);
+			section.count *= section.shape[d];
+		}
+		switch (dtype) {
+		case kDTypeFloat32:	section.dtype = torch::kFloat32;	break;
+		case kDTypeFloat64:	section.dtype = torch::kFloat64;	break;
+		case kDTypeFloat16:	section.dtype = torch::kFloat16;	break;
+		case kDTypeInt64:	section.dtype = torch::kInt64;		break;
+		case kDTypeInt32:	section.dtype = torch::kInt32;		break;
+		case kDTypeUInt8:	section.dtype = torch::kUInt8;		break;
+		default:
+			verify(false); // unknown dtype
+		}
+
+		uint64_t offset, nbytes;
+		read(&offset, 8);
+		read(&nbytes, 8);
+		read(&section.crc, 4);
+		section.has_crc = true;
+		section.offset = offset;
+		verify(offset >= data_offset && (int64_t)(offset + nbytes) <= size);
+		verify((int64_t)nbytes == section.count * (int64_t)c10::elementSize(section.dtype));
+		m_sections[name] = section;
+	}
+}
+
+void ModelImporter::Add(const char *name, int64_t count) {
+	Section section;
+	section.offset = m_size * sizeof(float);
+	section.count = count;
+	section.dtype = torch::kFloat32;
+	section.has_crc = false;
+	section.crc = 0;
+	m_sections[name] = section;
 	m_size += count;
 }
 
@@ -117,19 +223,29 @@ void ModelImporter::Initialize(const std::string &name, torch::Tensor &tensor) c
 	const auto iter = m_sections.find(name);
 	assert(iter != m_sections.end());
 
-	const auto &pos = iter->second;
-	auto offset = pos.first;
-	auto size = pos.second;
-	int count = tensor.numel();
-	assert(count == size);
-	assert(tensor.dtype() == torch::kFloat32);
-
-	count = size * sizeof(float);
-	auto p = (char*)malloc(count);
-	m_fdata->Seek(offset * sizeof(float));
-	m_fdata->Read(p, count);
-	auto created = torch::from_blob(p, tensor.sizes(), torch::Deleter(free), torch::kFloat32);
-	tensor = created.to(tensor.device());
+	const auto &section = iter->second;
+	assert(tensor.numel() == section.count);
+	auto nbytes = section.count * (int64_t)c10::elementSize(section.dtype);
+	assert(section.offset + nbytes <= m_fdata->size());
+
+	auto p = (char*)(m_fdata->data() + section.offset);
+	if (section.has_crc && crc32(p, nbytes) != section.crc) {
+		std::cerr << "Checksum mismatch: " << name << " in " << m_fullpath << "\n";
+		verify(false);
+	}
+
+	// zero-copy view into the mapping; the deleter holds on to the mapping until the last tensor goes away
+	auto fdata = m_fdata;
+	auto created = torch::from_blob(p, tensor.sizes(), [fdata](void*) {}, section.dtype);
+	if (section.dtype != tensor.scalar_type()) {
+		tensor = created.to(tensor.device(), tensor.scalar_type());
+	}
+	else if (tensor.device().is_cpu()) {
+		tensor = created;
+	}
+	else {
+		tensor = created.to(tensor.device()); // single copy straight from the page cache
+	}
 }
 
 int ModelImporter::ReportUnimported(const std::string &prefix) const {
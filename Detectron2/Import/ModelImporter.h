@@ -5,6 +5,24 @@
 
 namespace Detectron2
 {
+	/**
+		Two checkpoint sources are supported:
+
+		1. "{name}.d2w" under DataDir(), a self-describing container written by "ImportBaseline.py --d2w".
+		   It is used whenever it exists, so retrained weights can be swapped in without recompiling.
+		2. "{name}.data" raw float32 dump, whose layout only exists in generated Baseline/*.cpp files.
+
+		.d2w layout, all integers little-endian:
+
+			header:  char magic[4] = "D2WF", uint32 version, uint32 tensor_count, uint32 alignment,
+			         uint64 data_offset
+			index:   tensor_count entries of
+			         uint16 name_len, char name[name_len], uint8 dtype, uint8 ndim, int64 shape[ndim],
+			         uint64 offset, uint64 nbytes, uint32 crc32
+			data:    each tensor at its absolute "offset", aligned to "alignment" bytes (page size by default)
+
+		dtype is one of DType below; crc32 is zlib's crc32 over the tensor's nbytes.
+	*/
 	class ModelImporter {
 	public:
 		enum Model {
@@ -35,6 +53,17 @@ namespace Detectron2
 
 		static std::string DataDir();
 
+		// .d2w format
+		static const uint32_t kD2WVersion = 1;
+		enum DType {
+			kDTypeFloat32,
+			kDTypeFloat64,
+			kDTypeFloat16,
+			kDTypeInt64,
+			kDTypeInt32,
+			kDTypeUInt8
+		};
+
 	public:
 		ModelImporter(Model model);
 		ModelImporter(const std::string &filename);
@@ -57,12 +86,23 @@ namespace Detectron2
 		std::string import_model_final_997cc7();
 		std::string import_model_final_cafdb1();
 
-		std::unordered_map<std::string, std::pair<int, int>> m_sections;
-		int m_size;
-		void Add(const char *name, int count);
+		struct Section {
+			int64_t offset;					// in bytes
+			int64_t count;					// number of elements
+			torch::ScalarType dtype;
+			std::vector<int64_t> shape;		// empty when unknown
+			bool has_crc;
+			uint32_t crc;
+		};
+		std::unordered_map<std::string, Section> m_sections;
+		int64_t m_size;						// in floats, for Add() only
+		void Add(const char *name, int64_t count);
+
+		void Open(Model model);
+		void OpenD2W(const std::string &fullpath);
 
 		std::string m_fullpath;
-		std::shared_ptr<File> m_fdata;
+		std::shared_ptr<MappedFile> m_fdata;	// CPU tensors are views into it and keep it alive
 
 		mutable std::unordered_set<std::string> m_imported;
 	};
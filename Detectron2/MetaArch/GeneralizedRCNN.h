@@ -40,6 +40,7 @@ namespace Detectron2
 					The dict contains one key "instances" whose value is a :class:`Instances`.
 					The :class:`Instances` object has the following keys:
 					"pred_boxes", "pred_classes", "scores", "pred_masks", "pred_keypoints"
+					("pred_masks_local" or "pred_masks_rle" instead of "pred_masks", see MODEL.MASK_OUTPUT)
 		*/
 		virtual std::tuple<InstancesList, TensorMap>
 			forward(const std::vector<DatasetMapperOutput> &batched_inputs) override;
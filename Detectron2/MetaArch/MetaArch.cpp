@@ -1,11 +1,13 @@
 #include "Base.h"
 #include "MetaArch.h"
 
+#include <Detectron2/Modules/Conv/ConvBn2d.h>
 #include <Detectron2/Structures/PostProcessing.h>
 #include <Detectron2/MetaArch/GeneralizedRCNN.h>
 #include <Detectron2/MetaArch/PanopticFPN.h>
 #include <Detectron2/MetaArch/ProposalNetwork.h>
 #include <Detectron2/MetaArch/SemanticSegmentor.h>
+#include <ATen/Parallel.h>
 
 using namespace std;
 using namespace torch;
@@ -44,7 +46,8 @@ MetaArch Detectron2::build_model(CfgNode &cfg) {
 
 MetaArchImpl::MetaArchImpl(CfgNode &cfg) :
 	m_vis_period(cfg["VIS_PERIOD"].as<int>()),
-	m_input_format(cfg["INPUT.FORMAT"].as<string>())
+	m_input_format(cfg["INPUT.FORMAT"].as<string>()),
+	m_mask_output(PostProcessing::mask_output(cfg["MODEL.MASK_OUTPUT"].as<string>()))
 {
 	m_backbone = build_backbone(cfg);
 	register_module("backbone", m_backbone);
@@ -82,6 +85,17 @@ void MetaArchImpl::load_checkpoint(const std::string &checkpointer, bool jit) {
 	}
 }
 
+int MetaArchImpl::fuse_batchnorm() {
+	int count = 0;
+	for (auto &m : modules(false)) {
+		auto convbn = dynamic_pointer_cast<ConvBn2dImpl>(m);
+		if (convbn && convbn->fuse_batchnorm()) {
+			count++;
+		}
+	}
+	return count;
+}
+
 void MetaArchImpl::initialize(const ModelImporter &importer, const std::string &prefix) {
 	assert(prefix.empty());
 	m_backbone->initialize(importer, "backbone");
@@ -94,6 +108,10 @@ torch::Device MetaArchImpl::device() const {
 
 ImageList MetaArchImpl::preprocess_image(const std::vector<DatasetMapperOutput> &batched_inputs,
 	int size_divisibility) {
+	if (batched_inputs[0].raw_resize) {
+		return preprocess_raw_image(batched_inputs, size_divisibility);
+	}
+
 	TensorVec images;
 	images.reserve(batched_inputs.size());
 	auto dev = device();
@@ -105,6 +123,114 @@ ImageList MetaArchImpl::preprocess_image(const std::vector<DatasetMapperOutput>
 	return ImageList::from_tensors(images, size_divisibility);
 }
 
+ImageList MetaArchImpl::preprocess_raw_image(const std::vector<DatasetMapperOutput> &batched_inputs,
+	int size_divisibility) {
+	int count = batched_inputs.size();
+	int channels = m_pixel_mean.size(0);
+	assert(channels == 3);
+	auto pixel_mean = m_pixel_mean.to(torch::kCPU, torch::kFloat32).contiguous();
+	auto pixel_std = m_pixel_std.to(torch::kCPU, torch::kFloat32).contiguous();
+	float mean[3], inv_std[3];
+	for (int c = 0; c < 3; c++) {
+		mean[c] = pixel_mean.data_ptr<float>()[c];
+		inv_std[c] = 1.0f / pixel_std.data_ptr<float>()[c];
+	}
+	// frames are BGR
+	bool swap_rb = (m_input_format == "RGB");
+
+	// source taps of every output column/row, same as cv::resize(INTER_LINEAR) but in float
+	struct Tap {
+		int lo, hi;
+		float w_hi;
+	};
+	auto taps = [](int src_size, int dst_size) {
+		vector<Tap> ret(dst_size);
+		double scale = (double)src_size / dst_size;
+		for (int i = 0; i < dst_size; i++) {
+			float f = (float)((i + 0.5) * scale - 0.5);
+			int lo = (int)floorf(f);
+			f -= lo;
+			if (lo < 0) {
+				lo = 0;
+				f = 0;
+			}
+			if (lo >= src_size - 1) {
+				lo = src_size - 1;
+				f = 0;
+			}
+			ret[i] = { lo, min(lo + 1, src_size - 1), f };
+		}
+		return ret;
+	};
+
+	vector<Tensor> frames;
+	vector<ImageSize> image_sizes;
+	vector<vector<Tap>> xtaps, ytaps;
+	frames.reserve(count);
+	image_sizes.reserve(count);
+	int max_h = 0, max_w = 0;
+	for (auto &x : batched_inputs) {
+		assert(x.raw_resize);
+		auto frame = x.image.cpu().contiguous();
+		assert(frame.dim() == 3 && frame.size(2) == 3 && frame.dtype() == torch::kUInt8);
+		auto &size = *x.raw_resize;
+		xtaps.push_back(taps(frame.size(1), size.width));
+		ytaps.push_back(taps(frame.size(0), size.height));
+		frames.push_back(frame);
+		image_sizes.push_back(size);
+		max_h = max(max_h, size.height);
+		max_w = max(max_w, size.width);
+	}
+	if (size_divisibility > 0) {
+		int stride = size_divisibility;
+		max_h = (max_h + (stride - 1)) / stride * stride;
+		max_w = (max_w + (stride - 1)) / stride * stride;
+	}
+
+	// padding is written by the same pass, so the batch needs no zero fill
+	auto batched = torch::empty({ count, channels, max_h, max_w }, torch::kFloat32);
+	float *out_data = batched.data_ptr<float>();
+	int64_t plane = (int64_t)max_h * max_w;
+	at::parallel_for(0, (int64_t)count * max_h, 16, [&](int64_t begin, int64_t end) {
+		for (int64_t row = begin; row < end; row++) {
+			int n = row / max_h;
+			int y = row % max_h;
+			auto &size = image_sizes[n];
+			float *out[3];
+			for (int c = 0; c < 3; c++) {
+				out[c] = out_data + (n * channels + c) * plane + (int64_t)y * max_w;
+			}
+			int w = 0;
+			if (y < size.height) {
+				w = size.width;
+				const uint8_t *src = frames[n].data_ptr<uint8_t>();
+				int64_t src_w = frames[n].size(1);
+				auto &ty = ytaps[n][y];
+				const uint8_t *row_lo = src + ty.lo * src_w * 3;
+				const uint8_t *row_hi = src + ty.hi * src_w * 3;
+				float wy = ty.w_hi;
+				auto &xs = xtaps[n];
+				for (int x = 0; x < w; x++) {
+					auto &tx = xs[x];
+					const uint8_t *p00 = row_lo + tx.lo * 3, *p01 = row_lo + tx.hi * 3;
+					const uint8_t *p10 = row_hi + tx.lo * 3, *p11 = row_hi + tx.hi * 3;
+					for (int c = 0; c < 3; c++) {
+						int s = swap_rb ? 2 - c : c;
+						float top = p00[s] + (p01[s] - p00[s]) * tx.w_hi;
+						float bottom = p10[s] + (p11[s] - p10[s]) * tx.w_hi;
+						float v = top + (bottom - top) * wy;
+						out[c][x] = (v - mean[c]) * inv_std[c];
+					}
+				}
+			}
+			for (int c = 0; c < 3; c++) {
+				std::fill(out[c] + w, out[c] + max_w, 0.0f);
+			}
+		}
+	});
+	return ImageList(batched.to(device()), move(image_sizes));
+}
+
 InstancesList MetaArchImpl::get_gt_instances(const std::vector<DatasetMapperOutput> &batched_inputs) {
 	InstancesList gt_instances;
 	if (batched_inputs[0].instances) {
@@ -145,7 +271,7 @@ InstancesList MetaArchImpl::_postprocess(const InstancesList &instances,
 
 		int height = input_per_image.height ? *input_per_image.height : image_size.height;
 		int width = input_per_image.width ? *input_per_image.width : image_size.width;
-		auto r = PostProcessing::detector_postprocess(results_per_image, height, width);
+		auto r = PostProcessing::detector_postprocess(results_per_image, height, width, 0.5, m_mask_output);
 		auto m = make_shared<Instances>(ImageSize{ height, width });
 		m->set("instances", r);
 		processed_results.push_back(m);
@@ -3,6 +3,7 @@
 #include <Detectron2/Utils/CfgNode.h>
 #include <Detectron2/Structures/ImageList.h>
 #include <Detectron2/Structures/Instances.h>
+#include <Detectron2/Structures/PostProcessing.h>
 #include <Detectron2/Modules/FPN/FPN.h>
 #include <Detectron2/Modules/RPN/RPN.h>
 
@@ -18,6 +19,10 @@ namespace Detectron2
 		InstancesPtr proposals;					// precomputed proposals
 		std::shared_ptr<torch::Tensor> sem_seg;	// groundtruth of semantic segments
 
+		// When set, image is the raw (H, W, 3) BGR uint8 frame, and preprocess_image() converts it to
+		// INPUT.FORMAT, bilinearly resizes it to this size, normalizes and pads it in a single pass.
+		std::shared_ptr<ImageSize> raw_resize;
+
 		InstancesPtr get_instances() const { return instances; }
 		InstancesPtr get_proposals() const { return proposals; }
 	};
@@ -30,6 +35,10 @@ namespace Detectron2
 		virtual ~MetaArchImpl() {}
 		void load_checkpoint(const std::string &checkpointer, bool jit);
 
+		// Inference only: folds every FrozenBatchNorm2d into its preceding conv (see ConvBn2dImpl::fuse_batchnorm)
+		// across backbone, FPN and heads. Call after load_checkpoint(). Returns number of layers folded.
+		int fuse_batchnorm();
+
 		torch::Device device() const;
 
 		virtual void initialize(const ModelImporter &importer, const std::string &prefix);
@@ -54,9 +63,16 @@ namespace Detectron2
 		torch::Tensor m_pixel_mean;
 		torch::Tensor m_pixel_std;
 
+		// form of the output instance masks, from MODEL.MASK_OUTPUT
+		MaskOutput m_mask_output;
+
 		// Normalize, pad and batch the input images.
 		ImageList preprocess_image(const std::vector<DatasetMapperOutput> &batched_inputs, int size_divisibility);
 
+		// preprocess_image() of raw_resize inputs: one multithreaded pass from the uint8 frames straight into
+		// their slots of the padded float batch.
+		ImageList preprocess_raw_image(const std::vector<DatasetMapperOutput> &batched_inputs, int size_divisibility);
+
 		InstancesList get_gt_instances(const std::vector<DatasetMapperOutput> &batched_inputs);
 		torch::Tensor get_gt_sem_seg(const std::vector<DatasetMapperOutput> &batched_inputs, double ignore_value);
 
@@ -1,6 +1,7 @@
 #include "Base.h"
 #include "PanopticFPN.h"
 
+#include <Detectron2/Structures/MaskOps.h>
 #include <Detectron2/Structures/PostProcessing.h>
 
 using namespace std;
@@ -82,7 +83,9 @@ std::tuple<InstancesList, TensorMap> PanopticFPNImpl::forward(
 		int width = input_per_image.width ? *input_per_image.width : image_size.width;
 
 		auto sem_seg_r = PostProcessing::sem_seg_postprocess(sem_seg_result, image_size, height, width);
-		auto detector_r = PostProcessing::detector_postprocess(detector_result, height, width);
+		// combining needs the dense masks
+		auto detector_r = PostProcessing::detector_postprocess(detector_result, height, width, 0.5,
+			m_combine_on ? MaskOutput::kDense : m_mask_output);
 
 		auto output = make_shared<Instances>(ImageSize{ height, width }, false);
 		output->set("sem_seg", sem_seg_r);
@@ -97,6 +100,10 @@ std::tuple<InstancesList, TensorMap> PanopticFPNImpl::forward(
 
 std::shared_ptr<PanopticSegment> PanopticFPNImpl::combine_semantic_and_instance_outputs(
 	const InstancesPtr &instance_results, const torch::Tensor &semantic_results) {
+	if (semantic_results.device().is_cpu()) {
+		return combine_semantic_and_instance_outputs_cpu(instance_results, semantic_results);
+	}
+
 	auto ret = make_shared<PanopticSegment>();
 	auto &panoptic_seg = ret->seg;
 	auto &segments_info = ret->infos;
@@ -178,7 +185,129 @@ std::shared_ptr<PanopticSegment> PanopticFPNImpl::combine_semantic_and_instance_
 		info.category_id = semantic_label;
 		info.instance_id = 0;
 		info.area = mask_area;
-		segments_info.push_back(info);
+	}
+
+	return ret;
+}
+
+std::shared_ptr<PanopticSegment> PanopticFPNImpl::combine_semantic_and_instance_outputs_cpu(
+	const InstancesPtr &instance_results, const torch::Tensor &semantic_results_) {
+	auto ret = make_shared<PanopticSegment>();
+	auto &panoptic_seg = ret->seg;
+	auto &segments_info = ret->infos;
+
+	auto semantic_results = semantic_results_.to(torch::kInt64).contiguous();
+	int H = semantic_results.size(0);
+	int W = semantic_results.size(1);
+	panoptic_seg = torch::zeros({ H, W }, torch::kInt32);
+	int32_t *seg = panoptic_seg.data_ptr<int32_t>();
+
+	auto scores = instance_results->getTensor("scores").to(torch::kFloat32).contiguous();
+	auto pred_classes = instance_results->getTensor("pred_classes").to(torch::kInt64).contiguous();
+	auto boxes = instance_results->getTensor("pred_boxes").to(torch::kFloat32).contiguous();
+	auto instance_masks = instance_results->getTensor("pred_masks").to(torch::kBool).contiguous();
+	int count = scores.size(0);
+	const float *score_data = scores.data_ptr<float>();
+	const int64_t *class_data = pred_classes.data_ptr<int64_t>();
+	const float *box_data = boxes.data_ptr<float>();
+	const uint8_t *mask_data = (const uint8_t*)instance_masks.data_ptr<bool>();
+
+	// sort instance outputs by scores
+	vector<int> sorted_inds(count);
+	for (int i = 0; i < count; i++) sorted_inds[i] = i;
+	stable_sort(sorted_inds.begin(), sorted_inds.end(),
+		[=](int a, int b) { return score_data[a] > score_data[b]; });
+
+	int current_segment_id = 0;
+	segments_info.reserve(count);
+
+	// Add instances one-by-one, check for overlaps with existing ones
+	for (int inst_id : sorted_inds) {
+		auto score = score_data[inst_id];
+		if (score < m_combine_instances_confidence_threshold) {
+			break;
+		}
+		// MaskOps pastes nothing outside of this region
+		auto r = MaskOps::paste_region(box_data + inst_id * 4, H, W);
+		int x0 = r.px0, y0 = r.py0, x1 = r.px1, y1 = r.py1;
+		const uint8_t *mask = mask_data + (int64_t)inst_id * H * W;
+
+		int64_t mask_area = 0, intersect_area = 0;
+		for (int y = y0; y < y1; y++) {
+			for (int x = x0; x < x1; x++) {
+				int64_t p = (int64_t)y * W + x;
+				if (mask[p]) {
+					mask_area++;
+					intersect_area += (seg[p] > 0);
+				}
+			}
+		}
+		if (mask_area == 0) {
+			continue;
+		}
+		if (intersect_area * 1.0 / mask_area > m_combine_overlap_threshold) {
+			continue;
+		}
+
+		current_segment_id += 1;
+		for (int y = y0; y < y1; y++) {
+			for (int x = x0; x < x1; x++) {
+				int64_t p = (int64_t)y * W + x;
+				if (mask[p] && seg[p] == 0) {
+					seg[p] = current_segment_id;
+				}
+			}
+		}
+
+		segments_info.resize(segments_info.size() + 1);
+		SegmentInfo &info = segments_info.back();
+		info.id = current_segment_id;
+		info.isthing = true;
+		info.score = score;
+		info.category_id = class_data[inst_id];
+		info.instance_id = inst_id;
+		info.area = 0.0f;
+	}
+
+	// Add semantic results to remaining empty areas. Stuff masks don't overlap each other, so the area of
+	// every label is simply its count among the pixels no instance took.
+	const int64_t *semantic = semantic_results.data_ptr<int64_t>();
+	int64_t num_pixels = (int64_t)H * W;
+	vector<int64_t> areas;
+	for (int64_t p = 0; p < num_pixels; p++) {
+		if (seg[p] == 0) {
+			auto label = semantic[p];
+			assert(label >= 0);
+			if (label >= (int64_t)areas.size()) {
+				areas.resize(label + 1, 0);
+			}
+			areas[label]++;
+		}
+	}
+	vector<int32_t> stuff_ids(areas.size(), 0);
+	// 0 is a special "thing" class
+	for (int semantic_label = 1; semantic_label < (int)areas.size(); semantic_label++) {
+		auto mask_area = areas[semantic_label];
+		if (mask_area == 0 || mask_area < m_combine_stuff_area_limit) {
+			continue;
+		}
+
+		current_segment_id += 1;
+		stuff_ids[semantic_label] = current_segment_id;
+
+		segments_info.resize(segments_info.size() + 1);
+		SegmentInfo &info = segments_info.back();
+		info.id = current_segment_id;
+		info.isthing = false;
+		info.score = 0.0f;
+		info.category_id = semantic_label;
+		info.instance_id = 0;
+		info.area = mask_area;
+	}
+	for (int64_t p = 0; p < num_pixels; p++) {
+		if (seg[p] == 0) {
+			seg[p] = stuff_ids[semantic[p]];
+		}
 	}
 
 	return ret;
@@ -73,6 +73,12 @@ namespace Detectron2
 		*/
 		std::shared_ptr<PanopticSegment> combine_semantic_and_instance_outputs(
 			const InstancesPtr &instance_results, const torch::Tensor &semantic_results);
+
+		// CPU version of combine_semantic_and_instance_outputs(): each instance is only visited inside its
+		// box (where the pasted mask can be non-zero), and stuff areas come from one histogram of the
+		// remaining pixels, so there is no full-image pass per segment.
+		std::shared_ptr<PanopticSegment> combine_semantic_and_instance_outputs_cpu(
+			const InstancesPtr &instance_results, const torch::Tensor &semantic_results);
 	};
 	TORCH_MODULE(PanopticFPN);
 }
\ No newline at end of file
@@ -74,12 +74,18 @@ std::string FrozenBatchNorm2dImpl::toString() const {
 		FormatString(", eps=%f)", m_eps);
 }
 
+std::tuple<torch::Tensor, torch::Tensor> FrozenBatchNorm2dImpl::scale_and_shift() const {
+	auto scale = m_weight * (m_running_var + m_eps).rsqrt();
+	auto shift = m_bias - m_running_mean * scale;
+	return { scale, shift };
+}
+
 torch::Tensor FrozenBatchNorm2dImpl::forward(torch::Tensor x) {
 	if (x.requires_grad()) {
 		// When gradients are needed, F.batch_norm will use extra memory
 		// because its backward op computes gradients for weight/bias as well.
-		auto scale = m_weight * (m_running_var + m_eps).rsqrt();
-		auto bias = m_bias - m_running_mean * scale;
+		Tensor scale, bias;
+		tie(scale, bias) = scale_and_shift();
 		scale = scale.reshape({ 1, -1, 1, 1 });
 		bias = bias.reshape({ 1, -1, 1, 1 });
 		return x * scale + bias;
@@ -47,6 +47,9 @@ namespace Detectron2
 
 		std::string toString() const;
 
+		// the per-channel affine transform `x * scale + shift` this layer computes
+		std::tuple<torch::Tensor, torch::Tensor> scale_and_shift() const;
+
 		// implementing BatchNormImpl
 		virtual torch::Tensor &get_weight() override		{ return m_weight; }
 		virtual torch::Tensor &get_bias() override			{ return m_bias; }
@@ -1,6 +1,8 @@
 #include "Base.h"
 #include "ConvBn2d.h"
 
+#include <Detectron2/Modules/BatchNorm/FrozenBatchNorm2d.h>
+
 using namespace std;
 using namespace torch;
 using namespace Detectron2;
@@ -25,8 +27,34 @@ void ConvBn2dImpl::initialize(const ModelImporter &importer, const std::string &
 	}
 }
 
+bool ConvBn2dImpl::fuse_batchnorm() {
+	auto frozen = m_bn ? m_bn.as<FrozenBatchNorm2dImpl>() : nullptr;
+	if (!frozen) {
+		return false;
+	}
+
+	torch::NoGradGuard guard;
+	Tensor scale, shift;
+	tie(scale, shift) = frozen->scale_and_shift();
+	m_conv->weight.mul_(scale.reshape({ -1, 1, 1, 1 }));
+	if (m_conv->bias.defined()) {
+		m_conv->bias.mul_(scale).add_(shift);
+	}
+	else {
+		// conv already has an undefined "bias" registered by Conv2dImpl::reset(), which can't be registered again
+		m_fused_bias = register_buffer("fused_bias", shift.clone());
+	}
+
+	// "bn" stays registered, as torch::nn::Module cannot unregister it, but it's no longer called
+	m_bn = nullptr;
+	return true;
+}
+
 torch::Tensor ConvBn2dImpl::forward(torch::Tensor x) {
 	x = m_conv(x);
+	if (m_fused_bias.defined()) {
+		x.add_(m_fused_bias.view({ 1, -1, 1, 1 }));
+	}
 	if (m_bn) {
 		x = m_bn(x);
 	}
@@ -25,9 +25,17 @@ namespace Detectron2
 
 		torch::Tensor forward(torch::Tensor x);
 
+		/**
+			Inference only: when the norm layer is a FrozenBatchNorm2d, fold its fixed scale and shift into
+			conv's weight and bias, then drop the norm layer, saving one full pass over the activation.
+			Other norm layers are left untouched. Returns true if folded.
+		*/
+		bool fuse_batchnorm();
+
 	public:
 		torch::nn::Conv2d m_conv{ nullptr };
 		BatchNorm m_bn{ nullptr };
+		torch::Tensor m_fused_bias; // folded norm shift, for convs without bias
 		bool m_activation; // relu
 	};
 	TORCH_MODULE(ConvBn2d);
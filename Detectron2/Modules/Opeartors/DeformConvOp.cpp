@@ -32,7 +32,6 @@ torch::autograd::variable_list _DeformConv::forward(torch::autograd::AutogradCon
 	Tensor empty1 = input.new_empty(0);
 	ctx->saved_data["bufs_"] = TensorList{ empty0, empty1 };  // columns, ones
 
-	assert(input.is_cuda()); // cpu version not implemented
 	auto cur_im2col_step = _cal_im2col_step(input.size(0), im2col_step);
 	assert(input.size(0) % cur_im2col_step == 0); // im2col step must divide batchsize
 
@@ -22,7 +22,6 @@ torch::autograd::variable_list _ModulatedDeformConv::forward(torch::autograd::Au
 		bias = input.new_empty(1);
 	}
 	ctx->saved_data["with_bias"] = with_bias;
-	assert(input.is_cuda()); // cpu version not implemented
 
 	if (weight.requires_grad() || mask.requires_grad() || offset.requires_grad() || input.requires_grad()) {
 		ctx->save_for_backward({ input, offset, mask, weight, bias });
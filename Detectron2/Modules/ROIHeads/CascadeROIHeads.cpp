@@ -171,15 +171,7 @@ std::tuple<TensorMap, InstancesList> CascadeROIHeadsImpl::_forward_box(const Ten
 		FastRCNNOutputLayers predictor = get<0>(last);
 		TensorVec &predictions = get<1>(last);
 		InstancesList &proposals = get<2>(last);
-		auto boxes = predictor->predict_boxes(predictions, proposals);
-		auto pred_instances = get<0>(fast_rcnn_inference(
-			boxes,
-			scores,
-			image_sizes,
-			predictor->m_test_score_thresh,
-			predictor->m_test_nms_thresh,
-			predictor->m_test_topk_per_image
-		));
+		auto pred_instances = get<0>(predictor->inference(scores, predictions, proposals));
 		return { TensorMap{}, pred_instances };
 	}
 }
@@ -195,12 +187,11 @@ InstancesList CascadeROIHeadsImpl::_match_and_label_boxes(InstancesList &proposa
 	for (int i = 0; i < count; i++) {
 		auto proposals_per_image = proposals[i];
 		auto targets_per_image = targets[i];
-		auto match_quality_matrix = Boxes::pairwise_iou(
-			targets_per_image->getTensor("gt_boxes"), proposals_per_image->getTensor("proposal_boxes")
-		);
 		// proposal_labels are 0 or 1
 		Tensor matched_idxs, proposal_labels;
-		tie(matched_idxs, proposal_labels) = (*m_proposal_matchers[stage])(match_quality_matrix);
+		tie(matched_idxs, proposal_labels) = m_proposal_matchers[stage]->match_boxes(
+			targets_per_image->getTensor("gt_boxes"), proposals_per_image->getTensor("proposal_boxes")
+		);
 		Tensor gt_classes, gt_boxes;
 		if (targets_per_image->len() > 0) {
 			gt_classes = targets_per_image->getTensor("gt_classes").index(matched_idxs);
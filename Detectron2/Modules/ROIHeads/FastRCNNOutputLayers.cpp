@@ -83,6 +83,61 @@ std::tuple<InstancesPtr, torch::Tensor> Detectron2::fast_rcnn_inference_single_i
 	return { result, filter_inds.index({ Colon, 0 }) };
 }
 
+std::tuple<InstancesPtr, torch::Tensor> Detectron2::fast_rcnn_inference_single_image_deltas(
+	Box2BoxTransform &box2box_transform, const torch::Tensor &deltas_, const torch::Tensor &proposal_boxes_,
+	const torch::Tensor &scores_, const ImageSize &image_shape,
+	float score_thresh, float nms_thresh, int topk_per_image) {
+	torch::Tensor deltas = deltas_;
+	torch::Tensor proposal_boxes = proposal_boxes_;
+	torch::Tensor scores = scores_;
+	// decoding with clamped dw/dh only yields non-finite boxes from non-finite inputs
+	auto valid_mask = torch::isfinite(deltas).all(1)
+		.bitwise_and(torch::isfinite(proposal_boxes).all(1))
+		.bitwise_and(torch::isfinite(scores).all(1));
+	if (!valid_mask.all().item<bool>()) {
+		deltas = deltas.index(valid_mask);
+		proposal_boxes = proposal_boxes.index(valid_mask);
+		scores = scores.index(valid_mask);
+	}
+
+	scores = scores.index({ Colon, Slice(None, -1) });
+	auto num_bbox_reg_classes = deltas.size(1) / 4;
+
+	// Filter results based on detection scores, before any box is decoded
+	auto filter_mask = scores > score_thresh;  // R x K
+	// R' x 2. First column contains indices of the R predictions;
+	// Second column contains indices of classes.
+	auto filter_inds = filter_mask.nonzero();
+	auto rows = filter_inds.index({ Colon, 0 });
+	if (num_bbox_reg_classes == 1) {
+		deltas = deltas.index(rows);
+	}
+	else {
+		deltas = deltas.view({ -1, num_bbox_reg_classes, 4 }).index(filter_mask);
+	}
+	scores = scores.index(filter_mask);
+
+	// Decode and clip the surviving (proposal, class) pairs only
+	auto boxes = Boxes::boxes(box2box_transform.apply_deltas(deltas, proposal_boxes.index(rows)));
+	boxes->clip(image_shape);
+	auto t_boxes = boxes->tensor();
+
+	// Apply per-class NMS
+	auto keep = batched_nms(t_boxes, scores, filter_inds.index({ Colon, 1 }), nms_thresh);
+	if (topk_per_image >= 0) {
+		keep = keep.index({ Slice(None, topk_per_image) });
+	}
+	t_boxes = t_boxes.index(keep);
+	scores = scores.index(keep);
+	filter_inds = filter_inds.index(keep);
+
+	auto result = make_shared<Instances>(image_shape);
+	result->set("pred_boxes", t_boxes);
+	result->set("scores", scores);
+	result->set("pred_classes", filter_inds.index({ Colon, 1 }));
+	return { result, filter_inds.index({ Colon, 0 }) };
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 FastRCNNOutputLayersImpl::FastRCNNOutputLayersImpl(CfgNode &cfg, const ShapeSpec &input_shape,
@@ -129,11 +184,39 @@ TensorMap FastRCNNOutputLayersImpl::losses(const TensorVec &predictions, const I
 
 std::tuple<InstancesList, TensorVec> FastRCNNOutputLayersImpl::inference(const TensorVec &predictions,
 	const InstancesList &proposals) {
-	auto boxes = predict_boxes(predictions, proposals);
-	auto scores = predict_probs(predictions, proposals);
+	return inference(predict_probs(predictions, proposals), predictions, proposals);
+}
+
+std::tuple<InstancesList, TensorVec> FastRCNNOutputLayersImpl::inference(const TensorVec &scores,
+	const TensorVec &predictions, const InstancesList &proposals) {
 	auto image_shapes = proposals.getImageSizes();
-	return fast_rcnn_inference(boxes, scores, image_shapes,
-		m_test_score_thresh, m_test_nms_thresh, m_test_topk_per_image);
+	if (m_box2box_transform->box_dim() != 4) {
+		auto boxes = predict_boxes(predictions, proposals);
+		return fast_rcnn_inference(boxes, scores, image_shapes,
+			m_test_score_thresh, m_test_nms_thresh, m_test_topk_per_image);
+	}
+
+	InstancesList instances_list;
+	TensorVec kept_indices;
+	if (proposals.empty()) {
+		return { instances_list, kept_indices };
+	}
+	auto deltas = predictions[1].split_with_sizes(proposals.getLenVec());
+	auto proposal_boxes = proposals.getTensorVec("proposal_boxes");
+	int count = scores.size();
+	instances_list.reserve(count);
+	kept_indices.reserve(count);
+	for (int i = 0; i < count; i++) {
+		InstancesPtr instances;
+		torch::Tensor kept;
+		tie(instances, kept) = fast_rcnn_inference_single_image_deltas(
+			*m_box2box_transform, deltas[i], proposal_boxes[i], scores[i], image_shapes[i],
+			m_test_score_thresh, m_test_nms_thresh, m_test_topk_per_image
+		);
+		instances_list.push_back(instances);
+		kept_indices.push_back(kept);
+	}
+	return { instances_list, kept_indices };
 }
 
 TensorVec FastRCNNOutputLayersImpl::predict_boxes_for_gt_classes(const TensorVec &predictions,
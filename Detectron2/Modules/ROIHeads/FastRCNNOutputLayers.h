@@ -52,6 +52,17 @@ namespace Detectron2
 		const torch::Tensor &boxes, const torch::Tensor &scores, const ImageSize &image_shape,
 		float score_thresh, float nms_thresh, int topk_per_image);
 
+	/**
+		Same as `fast_rcnn_inference_single_image`, but takes the undecoded box regression deltas (Ri, K * 4) or
+		(Ri, 4) and the proposal boxes (Ri, 4) instead of decoded boxes. Score filtering runs first, and deltas are
+		decoded and clipped only for the (proposal, class) pairs that pass it. Rows with non-finite deltas are
+		dropped, as rows with non-finite boxes are in `fast_rcnn_inference_single_image`.
+	*/
+	std::tuple<InstancesPtr, torch::Tensor> fast_rcnn_inference_single_image_deltas(
+		Box2BoxTransform &box2box_transform, const torch::Tensor &deltas, const torch::Tensor &proposal_boxes,
+		const torch::Tensor &scores, const ImageSize &image_shape,
+		float score_thresh, float nms_thresh, int topk_per_image);
+
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	// FastRCNNOutputLayers: Two linear layers for predicting Fast R-CNN outputs:
@@ -95,6 +106,10 @@ namespace Detectron2
 		*/
 		std::tuple<InstancesList, TensorVec> inference(const TensorVec &predictions, const InstancesList &proposals);
 
+		// Same as inference(), but with given class probabilities for each image, e.g. averaged over cascade stages
+		std::tuple<InstancesList, TensorVec> inference(const TensorVec &scores, const TensorVec &predictions,
+			const InstancesList &proposals);
+
 		/**
 			Returns:
 				list[Tensor]: A list of Tensors of predicted boxes for GT classes in case of
@@ -159,11 +159,10 @@ InstancesList ROIHeadsImpl::label_and_sample_proposals(InstancesList &proposals,
 		auto proposals_per_image = proposals[i];
 		auto targets_per_image = targets[i];
 		bool has_gt = targets_per_image->len() > 0;
-		auto match_quality_matrix = Boxes::pairwise_iou(
+		Tensor matched_idxs, matched_labels;
+		tie(matched_idxs, matched_labels) = m_proposal_matcher.match_boxes(
 			targets_per_image->getTensor("gt_boxes"), proposals_per_image->getTensor("proposal_boxes")
 		);
-		Tensor matched_idxs, matched_labels;
-		tie(matched_idxs, matched_labels) = m_proposal_matcher(match_quality_matrix);
 		Tensor sampled_idxs, gt_classes;
 		tie(sampled_idxs, gt_classes) = _sample_proposals(
 			matched_idxs, matched_labels, targets_per_image->getTensor("gt_classes")
@@ -64,11 +64,11 @@ InstancesList RROIHeadsImpl::label_and_sample_proposals(InstancesList &proposals
 		auto proposals_per_image = proposals[i];
 		auto targets_per_image = targets[i];
 		bool has_gt = targets_per_image->len() > 0;
-		auto match_quality_matrix = RotatedBoxes::pairwise_iou_rotated(
-			targets_per_image->getTensor("gt_boxes"), proposals_per_image->getTensor("proposal_boxes")
-		);
 		Tensor matched_idxs, matched_labels;
-		tie(matched_idxs, matched_labels) = m_proposal_matcher(match_quality_matrix);
+		tie(matched_idxs, matched_labels) = m_proposal_matcher.match_boxes(
+			targets_per_image->getTensor("gt_boxes"), proposals_per_image->getTensor("proposal_boxes"),
+			[](const Tensor &gt, const Tensor &pred) { return RotatedBoxes::pairwise_iou_rotated(gt, pred); }
+		);
 		Tensor sampled_idxs, gt_classes;
 		tie(sampled_idxs, gt_classes) = _sample_proposals(
 			matched_idxs, matched_labels, targets_per_image->getTensor("gt_classes")
@@ -39,7 +39,8 @@ namespace Detectron2
 		*/
 		ROIAlignImpl(const Size2D &output_size, float spatial_scale, int sampling_ratio, bool aligned = true);
 
-		// input: NCHW images
+		// input: NCHW images; channels-last inputs are pooled by a channel-inner CPU kernel and produce
+		//        channels-last outputs
 		// rois : Bx5 boxes.First column is the index into N.The other 4 columns are xyxy.
 		virtual torch::Tensor forward(const torch::Tensor &input, const torch::Tensor &rois) override;
 		virtual std::string toString() const override;
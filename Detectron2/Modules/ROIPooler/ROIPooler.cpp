@@ -104,9 +104,10 @@ Tensor ROIPoolerImpl::forward(const TensorVec &x, const BoxesList &box_lists) {
 	auto num_channels = x[0].size(1);
 	auto output_height = m_output_size.height;
 
+	// keep channels-last features channels-last, so level poolers can use their channel-inner kernels
 	auto output = torch::zeros(
 		{ num_boxes, num_channels, output_height, output_height },
-		dtype(x[0].dtype()).device(x[0].device()));
+		dtype(x[0].dtype()).device(x[0].device()).memory_format(x[0].suggest_memory_format()));
 
 	for (int level = 0; level < num_level_assignments; level++) {
 		auto x_level = x[level];
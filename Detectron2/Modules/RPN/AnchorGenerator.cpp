@@ -59,3 +59,33 @@ void AnchorGeneratorImpl::register_cell_anchors(const TensorVec &cell_anchors) {
 		register_buffer(FormatString("%d", i), cell_anchors[i]);
 	}
 }
+
+Tensor AnchorGeneratorImpl::find_cached_anchors(int level, const pair<int, int> &size, torch::Device device) {
+	if (device != m_anchor_cache_device) {
+		clear_anchor_cache();
+		m_anchor_cache_device = device;
+		return Tensor();
+	}
+	auto iter = m_anchor_cache.find(AnchorKey{ level, size.first, size.second });
+	if (iter == m_anchor_cache.end()) {
+		return Tensor();
+	}
+	m_anchor_lru.splice(m_anchor_lru.begin(), m_anchor_lru, iter->second);
+	return iter->second->second;
+}
+
+void AnchorGeneratorImpl::cache_anchors(int level, const pair<int, int> &size, const Tensor &anchors) {
+	AnchorKey key{ level, size.first, size.second };
+	assert(m_anchor_cache.find(key) == m_anchor_cache.end());
+	if (m_anchor_lru.size() >= kAnchorCacheSize) {
+		m_anchor_cache.erase(m_anchor_lru.back().first);
+		m_anchor_lru.pop_back();
+	}
+	m_anchor_lru.push_front({ key, anchors });
+	m_anchor_cache[key] = m_anchor_lru.begin();
+}
+
+void AnchorGeneratorImpl::clear_anchor_cache() {
+	m_anchor_cache.clear();
+	m_anchor_lru.clear();
+}
@@ -2,6 +2,8 @@
 
 #include <Detectron2/Structures/ShapeSpec.h>
 
+#include <map>
+
 namespace Detectron2
 {
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -23,7 +25,7 @@ namespace Detectron2
 			int num_features);
 
 	public:
-		AnchorGeneratorImpl(int box_dim) : m_box_dim(box_dim) {}
+		AnchorGeneratorImpl(int box_dim) : m_box_dim(box_dim), m_anchor_cache_device(torch::kCPU) {}
 		virtual ~AnchorGeneratorImpl() {}
 
 		int box_dim() const { return m_box_dim; }
@@ -46,6 +48,22 @@ namespace Detectron2
 
 		// this was done by BufferList in original coding:
 		void register_cell_anchors(const TensorVec &cell_anchors);
+
+		// Anchors of one feature level depend only on its grid size, so they are kept across forward() calls,
+		// keyed by (level, grid height, grid width) and bounded by LRU. Cached tensors are shared with callers
+		// and must not be modified in place. A change of device drops the whole cache.
+		torch::Tensor find_cached_anchors(int level, const std::pair<int, int> &size, torch::Device device);
+		void cache_anchors(int level, const std::pair<int, int> &size, const torch::Tensor &anchors);
+		void clear_anchor_cache();
+
+	private:
+		static constexpr int kAnchorCacheSize = 32;
+
+		typedef std::tuple<int, int, int> AnchorKey;
+		typedef std::list<std::pair<AnchorKey, torch::Tensor>> AnchorLRU;
+		AnchorLRU m_anchor_lru; // most recently used first
+		std::map<AnchorKey, AnchorLRU::iterator> m_anchor_cache;
+		torch::Device m_anchor_cache_device;
 	};
 	TORCH_MODULE(AnchorGenerator);
 
@@ -61,6 +61,7 @@ vector<int> DefaultAnchorGeneratorImpl::num_anchors() const {
 }
 
 void DefaultAnchorGeneratorImpl::initialize(const ModelImporter &importer, const std::string &prefix) {
+	clear_anchor_cache();
 	for (int i = 0; i < m_cell_anchors.size(); i++) {
 		importer.Initialize(prefix + FormatString(".cell_anchors.%d", i), m_cell_anchors[i]);
 	}
@@ -79,12 +80,20 @@ BoxesList DefaultAnchorGeneratorImpl::forward(const TensorVec &features) {
 		auto &size = grid_sizes[i];
 		auto &stride = m_strides[i];
 		auto &base_anchors = m_cell_anchors[i];
+		auto cached = find_cached_anchors(i, size, base_anchors.device());
+		if (cached.defined()) {
+			anchors.push_back(cached);
+			continue;
+		}
+
 		auto offsets = _create_grid_offsets(size, stride, m_offset, base_anchors.device());
 		auto shift_x = offsets[0];
 		auto shift_y = offsets[1];
 
 		auto shifts = torch::stack({ shift_x, shift_y, shift_x, shift_y }, 1);
-		anchors.push_back((shifts.view({ -1, 1, 4 }) + base_anchors.view({ 1, -1, 4 })).reshape({ -1, 4 }));
+		auto level_anchors = (shifts.view({ -1, 1, 4 }) + base_anchors.view({ 1, -1, 4 })).reshape({ -1, 4 });
+		cache_anchors(i, size, level_anchors);
+		anchors.push_back(level_anchors);
 	}
 	return anchors;
 }
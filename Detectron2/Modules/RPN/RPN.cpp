@@ -6,6 +6,9 @@
 #include "RPNOutputs.h"
 #include "RRPN.h"
 
+#include <ATen/Parallel.h>
+#include <numeric>
+
 using namespace std;
 using namespace torch;
 using namespace Detectron2;
@@ -57,13 +60,10 @@ std::tuple<TensorVec, BoxesList> RPNImpl::label_and_sample_anchors(const BoxesLi
 		ImageSize &image_size_i = image_sizes[i];
 		auto gt_boxes_i = gt_boxes[i]; // ground-truth boxes for i-th image
 
-		Tensor match_quality_matrix;
-		retry_if_cuda_oom([&]() {
-			match_quality_matrix = Boxes::pairwise_iou(gt_boxes_i, anchors);
-		});
+		// IoU is streamed over anchor chunks, the full (#gt x #anchors) matrix is never built
 		Tensor matched_idxs, gt_labels_i;
 		retry_if_cuda_oom([&]() {
-			tie(matched_idxs, gt_labels_i) = m_anchor_matcher(match_quality_matrix);
+			tie(matched_idxs, gt_labels_i) = m_anchor_matcher.match_boxes(gt_boxes_i, anchors.tensor());
 		});
 		// Matching is memory-expensive and may result in CPU tensors. But the result is small
 		gt_labels_i = gt_labels_i.to(gt_boxes_i.device());
@@ -174,15 +174,29 @@ std::tuple<InstancesList, TensorMap> RPNImpl::forward(const ImageList &images,
 		// joint training with roi heads. This approach ignores the derivative
 		// w.r.t. the proposal boxes coordinates that are also network
 		// responses, so is approximate.
-		proposals = find_top_proposals(
-			outputs.predict_proposals(),
-			outputs.predict_objectness_logits(),
-			images,
-			m_nms_thresh,
-			m_pre_nms_topk[is_training() ? 1 : 0],
-			m_post_nms_topk[is_training() ? 1 : 0],
-			m_min_box_side_len,
-			is_training());
+		bool native = m_box2box_transform->box_dim() == 4 && features[0].device().is_cpu() &&
+			features[0].scalar_type() == torch::kFloat32;
+		if (native) {
+			proposals = find_top_proposals_cpu(
+				outputs,
+				images,
+				m_nms_thresh,
+				m_pre_nms_topk[is_training() ? 1 : 0],
+				m_post_nms_topk[is_training() ? 1 : 0],
+				m_min_box_side_len,
+				is_training());
+		}
+		else {
+			proposals = find_top_proposals(
+				outputs.predict_proposals(),
+				outputs.predict_objectness_logits(),
+				images,
+				m_nms_thresh,
+				m_pre_nms_topk[is_training() ? 1 : 0],
+				m_post_nms_topk[is_training() ? 1 : 0],
+				m_min_box_side_len,
+				is_training());
+		}
 	}
 	return { proposals, losses };
 }
@@ -272,3 +286,122 @@ InstancesList RPNImpl::find_top_proposals(const TensorVec &proposals,
 	}
 	return results;
 }
+
+InstancesList RPNImpl::find_top_proposals_cpu(RPNOutputs &outputs, const ImageList &images, float nms_thresh,
+	int pre_nms_topk, int post_nms_topk, float min_box_side_len, bool training) {
+	auto image_sizes = images.image_sizes();  // in (h, w) order
+	int num_images = image_sizes.size();
+	int num_levels = outputs.anchors().size();
+
+	TensorVec logits, deltas, anchors;
+	for (int level_id = 0; level_id < num_levels; level_id++) {
+		logits.push_back(outputs.predict_objectness_logits()[level_id].contiguous());
+		deltas.push_back(outputs.pred_anchor_deltas()[level_id].contiguous());
+		anchors.push_back(outputs.anchors()[level_id].to(torch::kFloat32).contiguous());
+	}
+	auto &weights = m_box2box_transform->weights();
+	float scale_clamp = m_box2box_transform->scale_clamp();
+
+	// 1. Select, decode, clip and filter top-k anchors for every (image, level)
+	struct Candidates {
+		vector<float> boxes;
+		vector<float> scores;
+	};
+	vector<Candidates> candidates(num_images * num_levels);
+	at::parallel_for(0, candidates.size(), 1, [&](int64_t begin, int64_t end) {
+		vector<int64_t> order;
+		for (int64_t task = begin; task < end; task++) {
+			int n = task / num_levels;
+			int level_id = task % num_levels;
+			auto &image_size = image_sizes[n];
+			auto &out = candidates[task];
+
+			int64_t Hi_Wi_A = logits[level_id].size(1);
+			const float *score = logits[level_id].data_ptr<float>() + n * Hi_Wi_A;
+			const float *delta = deltas[level_id].data_ptr<float>() + n * Hi_Wi_A * 4;
+			const float *anchor = anchors[level_id].data_ptr<float>();
+
+			// partial selection instead of a full sort; NaN ranks below everything
+			int64_t k = min((int64_t)pre_nms_topk, Hi_Wi_A);
+			order.resize(Hi_Wi_A);
+			iota(order.begin(), order.end(), 0);
+			partial_sort(order.begin(), order.begin() + k, order.end(), [score](int64_t a, int64_t b) {
+				float sa = score[a], sb = score[b];
+				return isnan(sb) ? !isnan(sa) : sa > sb;
+			});
+
+			out.boxes.reserve(k * 4);
+			out.scores.reserve(k);
+			for (int64_t i = 0; i < k; i++) {
+				auto idx = order[i];
+				const float *a = anchor + idx * 4;
+				const float *d = delta + idx * 4;
+
+				// see Box2BoxTransform::apply_deltas()
+				float width = a[2] - a[0];
+				float height = a[3] - a[1];
+				float ctr_x = a[0] + 0.5f * width;
+				float ctr_y = a[1] + 0.5f * height;
+				float dw = min(d[2] / weights.dw, scale_clamp);
+				float dh = min(d[3] / weights.dh, scale_clamp);
+				float pred_ctr_x = d[0] / weights.dx * width + ctr_x;
+				float pred_ctr_y = d[1] / weights.dy * height + ctr_y;
+				float pred_w = exp(dw) * width;
+				float pred_h = exp(dh) * height;
+				float box[4] = {
+					pred_ctr_x - 0.5f * pred_w, pred_ctr_y - 0.5f * pred_h,
+					pred_ctr_x + 0.5f * pred_w, pred_ctr_y + 0.5f * pred_h
+				};
+
+				if (!isfinite(score[idx]) || !isfinite(box[0]) || !isfinite(box[1]) ||
+					!isfinite(box[2]) || !isfinite(box[3])) {
+					assert(!training); // FloatingPointError: Predicted boxes or scores contain Inf/NaN. Training has diverged
+					continue;
+				}
+
+				// see Boxes::clip() and Boxes::nonempty()
+				box[0] = max(0.0f, min(box[0], (float)image_size.width));
+				box[1] = max(0.0f, min(box[1], (float)image_size.height));
+				box[2] = max(0.0f, min(box[2], (float)image_size.width));
+				box[3] = max(0.0f, min(box[3], (float)image_size.height));
+				if (box[2] - box[0] <= min_box_side_len || box[3] - box[1] <= min_box_side_len) {
+					continue;
+				}
+
+				out.boxes.insert(out.boxes.end(), box, box + 4);
+				out.scores.push_back(score[idx]);
+			}
+		}
+	});
+
+	// 2. For each image, run a per-level NMS, and choose topk results.
+	InstancesList results;
+	results.reserve(num_images);
+	for (int n = 0; n < num_images; n++) {
+		int64_t total = 0;
+		for (int level_id = 0; level_id < num_levels; level_id++) {
+			total += candidates[n * num_levels + level_id].scores.size();
+		}
+		auto boxes = torch::empty({ total, 4 }, torch::kFloat32);
+		auto scores_per_img = torch::empty({ total }, torch::kFloat32);
+		auto lvl = torch::empty({ total }, torch::kInt64);
+		int64_t offset = 0;
+		for (int level_id = 0; level_id < num_levels; level_id++) {
+			auto &c = candidates[n * num_levels + level_id];
+			int64_t count = c.scores.size();
+			memcpy(boxes.data_ptr<float>() + offset * 4, c.boxes.data(), count * 4 * sizeof(float));
+			memcpy(scores_per_img.data_ptr<float>() + offset, c.scores.data(), count * sizeof(float));
+			lvl.narrow(0, offset, count).fill_(level_id);
+			offset += count;
+		}
+
+		auto keep = batched_nms(boxes, scores_per_img, lvl, nms_thresh);
+		keep = keep.index({ Slice(None, post_nms_topk) });  // keep is already sorted
+
+		auto res = make_shared<Instances>(image_sizes[n]);
+		res->set("proposal_boxes", boxes.index(keep));
+		res->set("objectness_logits", scores_per_img.index(keep));
+		results.push_back(res);
+	}
+	return results;
+}
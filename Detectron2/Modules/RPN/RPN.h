@@ -9,6 +9,8 @@
 
 namespace Detectron2
 {
+	class RPNOutputs;
+
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// converted from modeling/proposal_generator/rpn.py
 
@@ -117,6 +119,15 @@ namespace Detectron2
 		virtual InstancesList find_top_proposals(const TensorVec &proposals,
 			const TensorVec &pred_objectness_logits, const ImageList &images, float nms_thresh,
 			int pre_nms_topk, int post_nms_topk, float min_box_side_len, bool training);
+
+		/**
+			Same result as find_top_proposals(outputs.predict_proposals(), ...) for axis-aligned boxes on CPU, in
+			one native pass: per image and level, in parallel, partially select the top-k objectness logits,
+			decode only those anchors, drop non-finite ones, clip and filter small boxes; then run per-level NMS
+			per image. Proposals for the other Hi*Wi*A - k anchors are never computed.
+		*/
+		InstancesList find_top_proposals_cpu(RPNOutputs &outputs, const ImageList &images, float nms_thresh,
+			int pre_nms_topk, int post_nms_topk, float min_box_side_len, bool training);
 	};
 	TORCH_MODULE(RPN);
 
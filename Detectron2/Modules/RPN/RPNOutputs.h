@@ -123,6 +123,11 @@ namespace Detectron2
 			return m_pred_objectness_logits;
 		}
 
+		// L tensors of shape (N, Hi*Wi*A, B), undecoded; see predict_proposals()
+		const TensorVec &pred_anchor_deltas() const { return m_pred_anchor_deltas; }
+		// L tensors of shape (Hi*Wi*A, B)
+		const BoxesList &anchors() const { return m_anchors; }
+
 	private:
 		std::shared_ptr<Box2BoxTransform> m_box2box_transform;
 		int m_batch_size_per_image;
@@ -30,13 +30,11 @@ std::tuple<TensorVec, BoxesList> RRPNImpl::label_and_sample_anchors(const BoxesL
 	for (int i = 0; i < count; i++) {
 		auto gt_boxes_i = gt_boxes[i]; // ground-truth boxes for i-th image
 
-		Tensor match_quality_matrix;
-		retry_if_cuda_oom([&]() {
-			match_quality_matrix = RotatedBoxes::pairwise_iou_rotated(gt_boxes_i, anchors);
-		});
+		// IoU is streamed over anchor chunks, the full (#gt x #anchors) matrix is never built
 		Tensor matched_idxs, gt_labels_i;
 		retry_if_cuda_oom([&]() {
-			tie(matched_idxs, gt_labels_i) = m_anchor_matcher(match_quality_matrix);
+			tie(matched_idxs, gt_labels_i) = m_anchor_matcher.match_boxes(gt_boxes_i, anchors.tensor(),
+				[](const Tensor &gt, const Tensor &pred) { return RotatedBoxes::pairwise_iou_rotated(gt, pred); });
 		});
 		// Matching is memory-expensive and may result in CPU tensors. But the result is small
 		gt_labels_i = gt_labels_i.to(gt_boxes_i.device());
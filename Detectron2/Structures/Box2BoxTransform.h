@@ -83,6 +83,9 @@ namespace Detectron2
 		*/
 		torch::Tensor apply_deltas_broadcast(torch::Tensor deltas, torch::Tensor boxes);
 
+		const Weights &weights() const { return m_weights; }
+		float scale_clamp() const { return m_scale_clamp; }
+
 	protected:
 		Weights m_weights;
 		float m_scale_clamp;
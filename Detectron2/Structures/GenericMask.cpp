@@ -2,6 +2,7 @@
 #include "GenericMask.h"
 
 #include <Detectron2/Utils/Utils.h>
+#include <Detectron2/Structures/MaskOps.h>
 
 using namespace std;
 using namespace cv;
@@ -62,30 +63,57 @@ GenericMask::GenericMask(const TensorVec &polygons, int height, int width) :
 	}
 }
 
-GenericMask::GenericMask(const mask_util::MaskObject &obj, int height, int width) {
+GenericMask::GenericMask(const mask_util::MaskObject &obj, int height, int width) :
+	m_height(height), m_width(width), m_has_mask(false), m_has_polygons(false), m_has_holes(0)
+{
+	auto h = obj->size.height;
+	auto w = obj->size.width;
+	assert(h == height && w == width);
 	if (!obj->counts_uncompressed.empty()) {
-		auto h = obj->size.height;
-		auto w = obj->size.width;
-		assert(h == height && w == width);
-		m_mask = mask_util::decode_single(mask_util::frPyObjects_single(obj, h, w));
+		m_rle = mask_util::frPyObjects_single(obj, h, w);
 	}
 	else {
 		assert(!obj->counts.empty());
-		m_mask = mask_util::decode_single(obj).index({ Colon, Colon });
+		m_rle = obj;
 	}
 }
 
+GenericMask::GenericMask(const torch::Tensor &local_mask, const torch::Tensor &box, int height, int width,
+	float threshold) :
+	m_height(height), m_width(width), m_has_mask(false), m_has_polygons(false), m_has_holes(0),
+	m_local_mask(local_mask), m_box(box), m_threshold(threshold)
+{
+	assert(local_mask.dim() == 2);
+	assert(box.numel() == 4);
+}
+
 torch::Tensor GenericMask::mask() {
 	if (!m_has_mask) {
-		m_mask = polygons_to_mask(m_polygons);
+		if (m_rle) {
+			m_mask = mask_util::decode_single(m_rle);
+		}
+		else if (m_local_mask.defined()) {
+			m_mask = MaskOps::paste_masks_in_image(m_local_mask.unsqueeze(0), m_box.reshape({ 1, 4 }),
+				{ m_height, m_width }, m_threshold)[0].to(torch::kUInt8);
+		}
+		else {
+			m_mask = polygons_to_mask(m_polygons);
+		}
 		m_has_mask = true;
 	}
 	return m_mask;
 }
 
+float GenericMask::area() {
+	if (!m_has_mask && m_rle) {
+		return mask_util::area_single(m_rle).item<float>();
+	}
+	return mask().sum().item<float>();
+}
+
 TensorVec GenericMask::polygons() {
 	if (!m_has_polygons) {
-		tie(m_polygons, m_has_holes) = mask_to_polygons(m_mask);
+		tie(m_polygons, m_has_holes) = mask_to_polygons(mask());
 		m_has_polygons = true;
 	}
 	return m_polygons;
@@ -93,8 +121,8 @@ TensorVec GenericMask::polygons() {
 
 bool GenericMask::has_holes() {
 	if (m_has_holes == 0) {
-		if (m_has_mask) {
-			tie(m_polygons, m_has_holes) = mask_to_polygons(m_mask);
+		if (m_has_mask || m_rle || m_local_mask.defined()) {
+			tie(m_polygons, m_has_holes) = mask_to_polygons(mask());
 			m_has_polygons = true;
 		}
 		else {
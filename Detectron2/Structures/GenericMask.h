@@ -29,15 +29,17 @@ namespace Detectron2
 		GenericMask(const TensorVec &polygons, int height, int width);
 		GenericMask(const mask_util::MaskObject &obj, int height, int width);
 
+		// box-local mask: an (M, M) soft mask relative to box (x0, y0, x1, y1), pasted only when first needed
+		GenericMask(const torch::Tensor &local_mask, const torch::Tensor &box, int height, int width,
+			float threshold = 0.5);
+
 		torch::Tensor polygons_to_mask(const TensorVec &polygons);
 
 		torch::Tensor mask();
 		TensorVec polygons();
 		bool has_holes();
 
-		float area() const {
-			return m_mask.sum().item<float>();
-		}
+		float area();
 
 		torch::Tensor bbox() const;
 
@@ -49,5 +51,9 @@ namespace Detectron2
 		bool m_has_mask;
 		bool m_has_polygons;
 		int m_has_holes;
+		mask_util::MaskObject m_rle;	// compressed RLE, decoded lazily into m_mask
+		torch::Tensor m_local_mask;		// box-local mask, pasted lazily into m_mask
+		torch::Tensor m_box;
+		float m_threshold;
 	};
 }
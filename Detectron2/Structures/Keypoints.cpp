@@ -2,6 +2,7 @@
 #include "Keypoints.h"
 
 #include <Detectron2/Modules/Opeartors/NewEmptyTensorOp.h>
+#include <ATen/Parallel.h>
 
 using namespace std;
 using namespace torch;
@@ -106,6 +107,10 @@ std::tuple<torch::Tensor, torch::Tensor> Keypoints::_keypoints_to_heatmap(torch:
 torch::Tensor Keypoints::heatmaps_to_keypoints(torch::Tensor maps, torch::Tensor rois) {
 	torch::NoGradGuard guard;
 
+	if (maps.device().is_cpu() && maps.dtype() == torch::kFloat32 && rois.dtype() == torch::kFloat32) {
+		return _heatmaps_to_keypoints_cpu(maps, rois);
+	}
+
 	auto offset_x = rois.index({ Colon, 0 });
 	auto offset_y = rois.index({ Colon, 1 });
 
@@ -158,3 +163,136 @@ torch::Tensor Keypoints::heatmaps_to_keypoints(torch::Tensor maps, torch::Tensor
 	}
 	return xy_preds;
 }
+
+// same arithmetic as upsample_bicubic2d(align_corners=false), see ATen/native/UpSample.h
+static const float kCubicA = -0.75f;
+
+static inline float cubic_convolution1(float x) {
+	return ((kCubicA + 2) * x - (kCubicA + 3)) * x * x + 1;
+}
+
+static inline float cubic_convolution2(float x) {
+	return ((kCubicA * x - 5 * kCubicA) * x + 8 * kCubicA) * x - 4 * kCubicA;
+}
+
+namespace {
+	// 4 taps of one output row/column: source indices clamped to the input, and their weights
+	struct CubicTaps {
+		int idx[4];
+		float w[4];
+	};
+}
+
+static void cubic_taps(int64_t input_size, int64_t output_size, vector<CubicTaps> &taps) {
+	float scale = (float)input_size / output_size;
+	taps.resize(output_size);
+	for (int64_t i = 0; i < output_size; i++) {
+		float real = scale * (i + 0.5) - 0.5;
+		int64_t in = (int64_t)floorf(real);
+		float t = real - in;
+		auto &tap = taps[i];
+		tap.w[0] = cubic_convolution2(t + 1.0f);
+		tap.w[1] = cubic_convolution1(t);
+		tap.w[2] = cubic_convolution1(1.0f - t);
+		tap.w[3] = cubic_convolution2((1.0f - t) + 1.0f);
+		for (int k = 0; k < 4; k++) {
+			tap.idx[k] = (int)min(max(in - 1 + k, (int64_t)0), input_size - 1);
+		}
+	}
+}
+
+torch::Tensor Keypoints::_heatmaps_to_keypoints_cpu(const torch::Tensor &maps_, const torch::Tensor &rois_) {
+	auto maps = maps_.contiguous();
+	auto rois = rois_.contiguous();
+	int64_t num_rois = maps.size(0);
+	int64_t num_keypoints = maps.size(1);
+	int64_t pool_h = maps.size(2);
+	int64_t pool_w = maps.size(3);
+	auto xy_preds = maps.new_zeros({ rois.size(0), num_keypoints, 4 });
+	if (num_rois == 0) {
+		return xy_preds;
+	}
+
+	const float *map_data = maps.data_ptr<float>();
+	const float *roi_data = rois.data_ptr<float>();
+	float *pred_data = xy_preds.data_ptr<float>();
+
+	// (x_int, y_int) and logit of every maximum, the softmax normalization is done as one batched op below
+	auto max_scores = torch::empty({ num_rois, num_keypoints }, maps.options());
+	float *max_data = max_scores.data_ptr<float>();
+	vector<int64_t> max_pos(num_rois * num_keypoints * 2);
+
+	at::parallel_for(0, num_rois, 1, [&](int64_t begin, int64_t end) {
+		vector<CubicTaps> xtaps, ytaps;
+		vector<float> rows;
+		for (int64_t i = begin; i < end; i++) {
+			const float *roi = roi_data + i * 4;
+			int64_t w = (int64_t)ceilf(max(roi[2] - roi[0], 1.0f));
+			int64_t h = (int64_t)ceilf(max(roi[3] - roi[1], 1.0f));
+			cubic_taps(pool_w, w, xtaps);
+			cubic_taps(pool_h, h, ytaps);
+			rows.resize(pool_h * w);
+
+			for (int64_t k = 0; k < num_keypoints; k++) {
+				const float *heatmap = map_data + (i * num_keypoints + k) * pool_h * pool_w;
+
+				// horizontal pass, at heatmap height
+				for (int64_t r = 0; r < pool_h; r++) {
+					const float *src = heatmap + r * pool_w;
+					float *dst = rows.data() + r * w;
+					for (int64_t x = 0; x < w; x++) {
+						auto &tap = xtaps[x];
+						dst[x] = src[tap.idx[0]] * tap.w[0] + src[tap.idx[1]] * tap.w[1] +
+							src[tap.idx[2]] * tap.w[2] + src[tap.idx[3]] * tap.w[3];
+					}
+				}
+
+				// vertical pass, only keeping the first maximum like argmax()
+				float best = -numeric_limits<float>::infinity();
+				int64_t best_x = 0, best_y = 0;
+				for (int64_t y = 0; y < h; y++) {
+					auto &tap = ytaps[y];
+					const float *r0 = rows.data() + tap.idx[0] * w;
+					const float *r1 = rows.data() + tap.idx[1] * w;
+					const float *r2 = rows.data() + tap.idx[2] * w;
+					const float *r3 = rows.data() + tap.idx[3] * w;
+					for (int64_t x = 0; x < w; x++) {
+						float v = r0[x] * tap.w[0] + r1[x] * tap.w[1] + r2[x] * tap.w[2] + r3[x] * tap.w[3];
+						if (v > best) {
+							best = v;
+							best_x = x;
+							best_y = y;
+						}
+					}
+				}
+
+				int64_t ik = i * num_keypoints + k;
+				max_data[ik] = best;
+				max_pos[ik * 2] = best_x;
+				max_pos[ik * 2 + 1] = best_y;
+			}
+		}
+	});
+
+	// Produce scores over the region H x W, but normalize with POOL_H x POOL_W,
+	// so that the scores of objects of different absolute sizes will be more comparable
+	auto pool_sums = (maps - max_scores.view({ num_rois, num_keypoints, 1, 1 })).exp_().sum({ 2, 3 }).contiguous();
+	const float *sum_data = pool_sums.data_ptr<float>();
+
+	at::parallel_for(0, num_rois * num_keypoints, 256, [&](int64_t begin, int64_t end) {
+		for (int64_t ik = begin; ik < end; ik++) {
+			const float *roi = roi_data + (ik / num_keypoints) * 4;
+			float width = max(roi[2] - roi[0], 1.0f);
+			float height = max(roi[3] - roi[1], 1.0f);
+			float width_correction = width / ceilf(width);
+			float height_correction = height / ceilf(height);
+
+			float *pred = pred_data + ik * 4;
+			pred[0] = ((float)max_pos[ik * 2] + 0.5f) * width_correction + roi[0];
+			pred[1] = ((float)max_pos[ik * 2 + 1] + 0.5f) * height_correction + roi[1];
+			pred[2] = max_data[ik];
+			pred[3] = 1.0f / sum_data[ik]; // exp(max - max) at the maximum itself
+		}
+	});
+	return xy_preds;
+}
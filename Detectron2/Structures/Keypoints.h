@@ -64,6 +64,15 @@ namespace Detectron2
 		*/
 		static torch::Tensor heatmaps_to_keypoints(torch::Tensor maps, torch::Tensor rois);
 
+	private:
+		/**
+			CPU version of heatmaps_to_keypoints() for float maps, giving the same result. Instead of
+			resizing every ROI to its full size and exponentiating it, the bicubic resize is split into
+			a row pass at heatmap height and a column pass that only tracks the running maximum, for all
+			ROIs and keypoints in parallel. The score at the maximum is exp(0) over the pooled sum.
+		*/
+		static torch::Tensor _heatmaps_to_keypoints_cpu(const torch::Tensor &maps, const torch::Tensor &rois);
+
 	public:
 		/**
 			keypoints: A Tensor, numpy array, or list of the x, y, and visibility of each keypoint.
@@ -3,6 +3,7 @@
 
 #include <Detectron2/Utils/Utils.h>
 #include <Detectron2/Data/Transform.h>
+#include <ATen/Parallel.h>
 
 using namespace std;
 using namespace torch;
@@ -28,11 +29,11 @@ std::tuple<torch::Tensor, TensorVec> MaskOps::_do_paste_mask(torch::Tensor masks
 	int y1_int = img_h;
 	if (skip_empty) {
 		auto clamped = torch::clamp(boxes.min_values(0).floor().index({ { None, 2} }) - 1, 0).to(torch::kInt32);
-		auto x0_int = clamped[0].item<int>();
-		auto y0_int = clamped[1].item<int>();
-		auto x1_int = torch::clamp(boxes.index({ Colon, 2 }).max().ceil() + 1, nullopt, img_w)
+		x0_int = clamped[0].item<int>();
+		y0_int = clamped[1].item<int>();
+		x1_int = torch::clamp(boxes.index({ Colon, 2 }).max().ceil() + 1, nullopt, img_w)
 			.to(torch::kInt32).item<int>();
-		auto y1_int = torch::clamp(boxes.index({ Colon, 3 }).max().ceil() + 1, nullopt, img_h)
+		y1_int = torch::clamp(boxes.index({ Colon, 3 }).max().ceil() + 1, nullopt, img_h)
 			.to(torch::kInt32).item<int>();
 	}
 	auto splitted = torch::split(boxes, 1, 1);  // each is Nx1
@@ -76,6 +77,12 @@ torch::Tensor MaskOps::paste_masks_in_image(torch::Tensor masks, torch::Tensor b
 	int img_h = image_shape.height;
 	int img_w = image_shape.width;
 
+	if (device.type() == torch::kCPU) {
+		auto img_masks = torch::zeros({ N, img_h, img_w }, threshold >= 0 ? torch::kBool : torch::kUInt8);
+		_paste_masks_cpu(masks, boxes, img_masks, threshold);
+		return img_masks;
+	}
+
 	// The actual implementation split the input into chunks,
 	// and paste them chunk by chunk.
 	int num_chunks;
@@ -117,6 +124,173 @@ torch::Tensor MaskOps::paste_masks_in_image(torch::Tensor masks, torch::Tensor b
 	return img_masks;
 }
 
+namespace {
+	// sampling positions of one row/column, see grid_sample(align_corners=false) with zero padding
+	struct PasteSample {
+		int lo, hi;		// mask cells, -1 when outside
+		float w_lo, w_hi;
+	};
+}
+
+MaskOps::PasteRegion MaskOps::paste_region(const float *box, int img_h, int img_w) {
+	return {
+		max((int)floor(box[0]) - 1, 0),
+		max((int)floor(box[1]) - 1, 0),
+		min((int)ceil(box[2]) + 1, img_w),
+		min((int)ceil(box[3]) + 1, img_h)
+	};
+}
+
+// Resamples one M x M mask over region r of its box, thresholding it in the same pass. Pixel (px, py) goes to
+// out[(py - r.py0) * row_stride + (px - r.px0) * col_stride]; pixels the mask doesn't reach are left untouched.
+static void paste_mask_region(const float *mask, int M, const float *box, const MaskOps::PasteRegion &r,
+	float threshold,
+	uint8_t *out, int64_t row_stride, int64_t col_stride, vector<PasteSample> &xs) {
+	float x0 = box[0], y0 = box[1], x1 = box[2], y1 = box[3];
+	auto sample = [M](int p, float b0, float b1) {
+		float m = (p + 0.5f - b0) / (b1 - b0) * M - 0.5f;
+		int lo = (int)floor(m);
+		float w_hi = m - lo;
+		PasteSample s{ lo, lo + 1, 1.0f - w_hi, w_hi };
+		if (s.lo < 0 || s.lo >= M) s.lo = -1;
+		if (s.hi < 0 || s.hi >= M) s.hi = -1;
+		return s;
+	};
+	xs.resize(r.px1 - r.px0);
+	for (int px = r.px0; px < r.px1; px++) {
+		xs[px - r.px0] = sample(px, x0, x1);
+	}
+
+	bool binary = threshold >= 0;
+	for (int py = r.py0; py < r.py1; py++) {
+		PasteSample sy = sample(py, y0, y1);
+		if (sy.lo < 0 && sy.hi < 0) {
+			continue;
+		}
+		const float *row_lo = sy.lo >= 0 ? mask + sy.lo * M : nullptr;
+		const float *row_hi = sy.hi >= 0 ? mask + sy.hi * M : nullptr;
+		uint8_t *out_row = out + (py - r.py0) * row_stride;
+		for (int px = r.px0; px < r.px1; px++) {
+			const PasteSample &sx = xs[px - r.px0];
+			float v = 0;
+			if (row_lo) {
+				if (sx.lo >= 0) v += sy.w_lo * sx.w_lo * row_lo[sx.lo];
+				if (sx.hi >= 0) v += sy.w_lo * sx.w_hi * row_lo[sx.hi];
+			}
+			if (row_hi) {
+				if (sx.lo >= 0) v += sy.w_hi * sx.w_lo * row_hi[sx.lo];
+				if (sx.hi >= 0) v += sy.w_hi * sx.w_hi * row_hi[sx.hi];
+			}
+			// for visualization and debugging, threshold < 0 keeps the soft values
+			out_row[(px - r.px0) * col_stride] = binary ? (v >= threshold) : (uint8_t)(v * 255);
+		}
+	}
+}
+
+void MaskOps::_paste_masks_cpu(const torch::Tensor &masks_, const torch::Tensor &boxes_,
+	torch::Tensor &img_masks, float threshold) {
+	auto masks = masks_.to(torch::kFloat32).contiguous();
+	auto boxes = boxes_.to(torch::kFloat32).contiguous();
+	int64_t N = masks.size(0);
+	int M = masks.size(-1);
+	int img_h = img_masks.size(1);
+	int img_w = img_masks.size(2);
+	const float *mask_data = masks.data_ptr<float>();
+	const float *box_data = boxes.data_ptr<float>();
+	uint8_t *out_data = threshold >= 0 ? (uint8_t*)img_masks.data_ptr<bool>() : img_masks.data_ptr<uint8_t>();
+
+	at::parallel_for(0, N, 1, [&](int64_t begin, int64_t end) {
+		vector<PasteSample> xs;
+		for (int64_t i = begin; i < end; i++) {
+			const float *box = box_data + i * 4;
+			auto r = paste_region(box, img_h, img_w);
+			if (r.empty()) {
+				continue;
+			}
+			uint8_t *out = out_data + i * img_h * img_w + r.py0 * img_w + r.px0;
+			paste_mask_region(mask_data + i * M * M, M, box, r, threshold, out, img_w, 1, xs);
+		}
+	});
+}
+
+std::vector<pycocotools::MaskObject> MaskOps::paste_masks_to_rle(torch::Tensor masks, torch::Tensor boxes,
+	const ImageSize &image_shape, float threshold) {
+	assert(masks.size(-1) == masks.size(-2)); // "Only square mask predictions are supported"
+	assert(threshold >= 0);
+	int64_t N = masks.size(0);
+	assert(boxes.size(0) == N);
+	int img_h = image_shape.height;
+	int img_w = image_shape.width;
+
+	std::vector<pycocotools::MaskObject> rles(N);
+	if (boxes.device().type() != torch::kCPU) {
+		// one instance at a time keeps the peak memory of a single (Himage, Wimage) mask
+		for (int64_t i = 0; i < N; i++) {
+			auto img_mask = paste_masks_in_image(masks.index({ Slice(i, i + 1) }),
+				boxes.index({ Slice(i, i + 1) }), image_shape, threshold);
+			rles[i] = pycocotools::encode_single(img_mask[0].to(torch::kUInt8));
+		}
+		return rles;
+	}
+
+	masks = masks.to(torch::kFloat32).contiguous();
+	boxes = boxes.to(torch::kFloat32).contiguous();
+	int M = masks.size(-1);
+	const float *mask_data = masks.data_ptr<float>();
+	const float *box_data = boxes.data_ptr<float>();
+
+	at::parallel_for(0, N, 1, [&](int64_t begin, int64_t end) {
+		vector<PasteSample> xs;
+		vector<uint8_t> local;
+		for (int64_t i = begin; i < end; i++) {
+			const float *box = box_data + i * 4;
+			auto r = paste_region(box, img_h, img_w);
+
+			// counts alternate between runs of 0s and 1s in column-major order, starting with 0s
+			auto obj = make_shared<pycocotools::MaskObjectImpl>();
+			obj->size = { img_h, img_w };
+			auto &counts = obj->counts_uncompressed;
+			int run = 0;
+			uint8_t value = 0;
+			auto add = [&](uint8_t v, int len) {
+				if (len == 0) {
+					return;
+				}
+				if (v != value) {
+					counts.push_back(run);
+					value = v;
+					run = 0;
+				}
+				run += len;
+			};
+
+			if (r.empty()) {
+				add(0, img_h * img_w);
+			}
+			else {
+				// pasted column-major, so every column of the box is one contiguous run of pixels
+				int region_h = r.py1 - r.py0;
+				local.assign((size_t)region_h * (r.px1 - r.px0), 0);
+				paste_mask_region(mask_data + i * M * M, M, box, r, threshold, local.data(), 1, region_h, xs);
+
+				add(0, r.px0 * img_h);
+				for (int px = r.px0; px < r.px1; px++) {
+					const uint8_t *col = local.data() + (size_t)(px - r.px0) * region_h;
+					add(0, r.py0);
+					for (int y = 0; y < region_h; y++) {
+						add(col[y], 1);
+					}
+					add(0, img_h - r.py1);
+				}
+				add(0, (img_w - r.px1) * img_h);
+			}
+			counts.push_back(run);
+			rles[i] = pycocotools::frPyObjects_single(obj, img_h, img_w);
+		}
+	});
+	return rles;
+}
+
 torch::Tensor MaskOps::paste_mask_in_image_old(torch::Tensor mask, torch::Tensor box, int img_h, int img_w,
 	float threshold) {
 	// Conversion from continuous box coordinates to discrete pixel coordinates
@@ -133,7 +307,7 @@ torch::Tensor MaskOps::paste_mask_in_image_old(torch::Tensor mask, torch::Tensor
 
 	cv::Mat mmask = image_to_mat(mask);
 	cv::resize(mmask, mmask, { samples_w, samples_h }, 0.0, 0.0, Transform::Interp::kBILINEAR);
-	mask = image_to_tensor(mmask);
+	mask = mat_to_tensor(mmask);
 	if (threshold >= 0) {
 		mask = (mask > threshold).to(torch::kUInt8);
 	}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Detectron2/Detectron2.h>
+#include <Detectron2/coco/mask.h>
 
 namespace Detectron2
 {
@@ -37,6 +38,37 @@ namespace Detectron2
 		static torch::Tensor paste_masks_in_image(torch::Tensor masks, torch::Tensor boxes,
 			const ImageSize &image_shape, float threshold = 0.5);
 
+		/**
+			Same as paste_masks_in_image(), but returns every pasted mask as COCO RLE instead of a
+			(Bimg, Himage, Wimage) tensor. On CPU each mask is resampled only inside its box and the
+			column-major runs are counted right there, so no image-sized buffer is ever allocated.
+
+			Args:
+				masks, boxes, image_shape: see paste_masks_in_image()
+				threshold (float): A threshold in [0, 1] for converting the (soft) masks to
+					binary masks.
+
+			Returns:
+				list[MaskObject]: Bimg compressed RLEs of size (Himage, Wimage).
+		*/
+		static std::vector<pycocotools::MaskObject> paste_masks_to_rle(torch::Tensor masks, torch::Tensor boxes,
+			const ImageSize &image_shape, float threshold = 0.5);
+
+		// pixels [px0, px1) x [py0, py1) a box can paste into, same bounds as skip_empty in _do_paste_mask(),
+		// but per box
+		struct PasteRegion {
+			int px0, py0, px1, py1;
+
+			bool empty() const { return px0 >= px1 || py0 >= py1; }
+		};
+
+		/**
+			Region of an img_h x img_w image outside of which paste_masks_in_image() and paste_masks_to_rle()
+			never set a pixel for box (x0, y0, x1, y1). Code that scans pasted masks only within their boxes
+			must use this, rather than its own bounds.
+		*/
+		static PasteRegion paste_region(const float *box, int img_h, int img_w);
+
 
 		// The below are the original paste function (from Detectron1) which has
 		// larger quantization error.
@@ -110,5 +142,18 @@ namespace Detectron2
 		*/
 		static std::tuple<torch::Tensor, TensorVec> _do_paste_mask(torch::Tensor masks, torch::Tensor boxes,
 			int img_h, int img_w, bool skip_empty = true);
+
+		/**
+			CPU version of paste_masks_in_image() giving the same result as _do_paste_mask(). Each mask is
+			bilinearly resampled only inside its own box (plus one pixel of border), thresholded in the same pass,
+			and written straight into its output plane; instances run in parallel.
+
+			Args:
+				masks: N, M, M
+				boxes: N, 4
+				img_masks: N, img_h, img_w, zero filled, kBool if threshold >= 0, otherwise kUInt8
+		*/
+		static void _paste_masks_cpu(const torch::Tensor &masks, const torch::Tensor &boxes,
+			torch::Tensor &img_masks, float threshold);
 	};
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "Base.h"
 #include "Matcher.h"
 
+#include "Boxes.h"
+
 using namespace std;
 using namespace torch;
 using namespace Detectron2;
@@ -45,7 +47,16 @@ std::tuple<torch::Tensor, torch::Tensor> Matcher::operator()(const torch::Tensor
 	torch::Tensor matched_vals, matches;
 	tie(matched_vals, matches) = match_quality_matrix.max(0);
 
-	auto match_labels = matches.new_full(matches.sizes(), 1, torch::kInt8);
+	auto match_labels = label_matches(matched_vals);
+
+	if (m_allow_low_quality_matches) {
+		set_low_quality_matches_(match_quality_matrix, match_labels);
+	}
+	return { matches, match_labels };
+}
+
+torch::Tensor Matcher::label_matches(const torch::Tensor &matched_vals) {
+	auto match_labels = matched_vals.new_full(matched_vals.sizes(), 1, torch::kInt8);
 	for (int i = 0; i < m_labels.size(); i++) {
 		auto label = m_labels[i];
 		auto low = m_thresholds[i];
@@ -53,9 +64,50 @@ std::tuple<torch::Tensor, torch::Tensor> Matcher::operator()(const torch::Tensor
 		auto low_high = (matched_vals >= low).bitwise_and(matched_vals < high);
 		match_labels.index_put_({ low_high }, label);
 	}
+	return match_labels;
+}
+
+std::tuple<torch::Tensor, torch::Tensor> Matcher::match_boxes(const torch::Tensor &gt_boxes,
+	const torch::Tensor &pred_boxes, const PairwiseQuality &pairwise, int64_t chunk_size) {
+	PairwiseQuality quality = pairwise;
+	if (!quality) {
+		quality = [](const Tensor &gt, const Tensor &pred) { return Boxes::pairwise_iou(gt, pred); };
+	}
+
+	int64_t M = gt_boxes.size(0);
+	int64_t N = pred_boxes.size(0);
+	if (M == 0 || N <= chunk_size) {
+		return (*this)(quality(gt_boxes, pred_boxes));
+	}
+
+	auto options = gt_boxes.options().dtype(torch::kFloat32);
+	auto matched_vals = torch::empty({ N }, options);
+	auto matches = torch::empty({ N }, options.dtype(torch::kInt64));
+	auto highest_quality_foreach_gt = torch::full({ M }, -INFINITY, options);
+	for (int64_t start = 0; start < N; start += chunk_size) {
+		auto length = min(chunk_size, N - start);
+		auto chunk = quality(gt_boxes, pred_boxes.narrow(0, start, length)).to(torch::kFloat32);
+		assert(torch::all(chunk >= 0).item<bool>());
+
+		Tensor chunk_vals, chunk_matches;
+		tie(chunk_vals, chunk_matches) = chunk.max(0);
+		matched_vals.narrow(0, start, length).copy_(chunk_vals);
+		matches.narrow(0, start, length).copy_(chunk_matches);
+		if (m_allow_low_quality_matches) {
+			highest_quality_foreach_gt = torch::max(highest_quality_foreach_gt, chunk.max_values(1));
+		}
+	}
+
+	auto match_labels = label_matches(matched_vals);
 
 	if (m_allow_low_quality_matches) {
-		set_low_quality_matches_(match_quality_matrix, match_labels);
+		// see set_low_quality_matches_(); the per-gt maximum is only known after the first pass
+		for (int64_t start = 0; start < N; start += chunk_size) {
+			auto length = min(chunk_size, N - start);
+			auto chunk = quality(gt_boxes, pred_boxes.narrow(0, start, length)).to(torch::kFloat32);
+			auto highest = (chunk == highest_quality_foreach_gt.index({ Colon, None })).any(0);
+			match_labels.narrow(0, start, length).masked_fill_(highest, 1);
+		}
 	}
 	return { matches, match_labels };
 }
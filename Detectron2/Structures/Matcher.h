@@ -52,6 +52,22 @@ namespace Detectron2
 		*/
 		std::tuple<torch::Tensor, torch::Tensor> operator()(const torch::Tensor &match_quality_matrix);
 
+		// pairwise quality of M ground-truth elements against N predicted elements, MxN
+		typedef std::function<torch::Tensor(const torch::Tensor &gt, const torch::Tensor &pred)> PairwiseQuality;
+
+		/**
+			Same result as operator()(pairwise(gt_boxes, pred_boxes)), without materializing the MxN matrix.
+			Quality is computed for chunk_size predictions at a time, keeping only the per-prediction running
+			max/argmax and, if low-quality matches are allowed, the per-gt max; a second pass over the chunks then
+			finds the predictions that reach it.
+
+			gt_boxes (Tensor): M ground-truth boxes
+			pred_boxes (Tensor): N predicted boxes
+			pairwise: quality function, Boxes::pairwise_iou if empty
+		*/
+		std::tuple<torch::Tensor, torch::Tensor> match_boxes(const torch::Tensor &gt_boxes,
+			const torch::Tensor &pred_boxes, const PairwiseQuality &pairwise = {}, int64_t chunk_size = 16384);
+
 		/**
 			Produce additional matches for predictions that have only low-quality matches. Specifically, for each
 			ground-truth G find the set of predictions that have maximum overlap with it (including ties); for each
@@ -62,6 +78,9 @@ namespace Detectron2
 		void set_low_quality_matches_(const torch::Tensor &match_quality_matrix, torch::Tensor &match_labels);
 
 	private:
+		// labels predictions by the level their best match quality falls into
+		torch::Tensor label_matches(const torch::Tensor &matched_vals);
+
 		std::vector<float> m_thresholds;
 		std::vector<int> m_labels;
 		bool m_allow_low_quality_matches;
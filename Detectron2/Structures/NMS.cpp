@@ -37,6 +37,10 @@ torch::Tensor torchvision::batched_nms(const torch::Tensor &boxes, const torch::
 torch::Tensor Detectron2::batched_nms(const torch::Tensor &boxes, const torch::Tensor &scores,
 	const torch::Tensor &idxs, float iou_threshold) {
 	assert(boxes.size(-1) == 4);
+	if (!boxes.is_cuda()) {
+		// native per-class NMS, buckets run in parallel; no offset trick nor per-class nonzero()
+		return detectron2::batched_nms_cpu(boxes.contiguous(), scores.contiguous(), idxs, iou_threshold);
+	}
 	// TODO may need better strategy.
 	// Investigate after having a fully-cuda NMS op.
 	if (boxes.size(0) < 40000) {
@@ -10,8 +10,16 @@ using namespace Detectron2;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MaskOutput PostProcessing::mask_output(const std::string &name) {
+	if (name == "dense") return MaskOutput::kDense;
+	if (name == "box") return MaskOutput::kBoxLocal;
+	if (name == "rle") return MaskOutput::kRLE;
+	assert(false);
+	return MaskOutput::kDense;
+}
+
 InstancesPtr PostProcessing::detector_postprocess(const InstancesPtr &results_,
-	int output_height, int output_width, float mask_threshold) {
+	int output_height, int output_width, float mask_threshold, MaskOutput mask_output) {
 	auto scale_x = (float)output_width / results_->image_size().width;
 	auto scale_y = (float)output_height / results_->image_size().height;
 	InstancesPtr results(new Instances({ output_height, output_width }, results_->move_fields()));
@@ -29,7 +37,20 @@ InstancesPtr PostProcessing::detector_postprocess(const InstancesPtr &results_,
 
 	results = (*results)[output_boxes->nonempty()];
 
-	if (results->has("pred_masks")) {
+	if (results->has("pred_masks") && mask_output != MaskOutput::kDense) {
+		auto masks = results->getTensor("pred_masks").index({ Colon, 0, Colon, Colon }); // N, 1, M, M
+		results->remove("pred_masks");
+		if (mask_output == MaskOutput::kBoxLocal) {
+			results->set("pred_masks_local", masks);
+		}
+		else {
+			auto rles = make_shared<SequenceVec<pycocotools::MaskObject>>();
+			rles->data() = MaskOps::paste_masks_to_rle(masks, results->getTensor("pred_boxes"),
+				results->image_size(), mask_threshold);
+			results->set("pred_masks_rle", rles);
+		}
+	}
+	else if (results->has("pred_masks")) {
 		retry_if_cuda_oom([&]() {
 			results->set("pred_masks",
 				MaskOps::paste_masks_in_image(
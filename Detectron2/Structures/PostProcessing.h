@@ -7,8 +7,18 @@ namespace Detectron2
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// converted from modeling/postprocessing.py
 
+	// How detector_postprocess() returns the masks of an R-CNN detector, see MODEL.MASK_OUTPUT.
+	enum class MaskOutput {
+		kDense,		// "pred_masks": (N, H, W) binary masks pasted into the output image
+		kBoxLocal,	// "pred_masks_local": (N, M, M) soft masks, each relative to its "pred_boxes"
+		kRLE		// "pred_masks_rle": a list of N COCO RLEs of the pasted binary masks
+	};
+
 	class PostProcessing {
 	public:
+		// parses MODEL.MASK_OUTPUT: "dense", "box" or "rle"
+		static MaskOutput mask_output(const std::string &name);
+
 		/**
 			Resize the output instances.
 			The input images are often resized when entering an object detector.
@@ -23,12 +33,15 @@ namespace Detectron2
 					`results.image_size` contains the input image resolution the detector sees.
 					This object might be modified in-place.
 				output_height, output_width: the desired output resolution.
+				mask_output: which form "pred_masks" is returned in. Only kDense creates a full
+					(N, output_height, output_width) tensor.
 
 			Returns:
 				Instances: the resized output from the model, based on the output resolution
 		*/
 		static InstancesPtr detector_postprocess(const InstancesPtr &results,
-			int output_height, int output_width, float mask_threshold = 0.5);
+			int output_height, int output_width, float mask_threshold = 0.5,
+			MaskOutput mask_output = MaskOutput::kDense);
 
 		/**
 			Return semantic segmentation predictions in the original resolution.
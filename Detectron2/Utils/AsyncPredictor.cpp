@@ -3,41 +3,46 @@
 
 #include "DefaultPredictor.h"
 
+#include <ATen/Parallel.h>
+#include <windows.h>
+
 using namespace std;
 using namespace torch;
 using namespace Detectron2;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-AsyncPredictor::AsyncPredictor(const CfgNode &cfg, int num_gpus) : m_put_idx(0), m_get_idx(0) {
-	auto _PredictWorker = [&](YAML::Node cfg) {
-		DefaultPredictor predictor(cfg); // doh' this cloning is unnecessary
-		while (true) {
-			int idx; torch::Tensor data;
-			{
-				std::unique_lock<std::mutex> lk(m_task_queue_mutex);
-				m_task_queue_ready.wait(lk, [=]() { return !m_task_queue.empty(); });
-			}
-			m_task_queue_mutex.lock();
-			if (m_task_queue.empty()) {
-				m_task_queue_mutex.unlock();
-				continue;
-			}
-			tie(idx, data) = m_task_queue.front();
-			if (idx >= 0) {
-				m_task_queue.pop_front();
-			}
-			m_task_queue_mutex.unlock();
+// pins calling thread to logical processors [first_core, first_core + count) of its processor group
+static void pin_current_thread(int first_core, int count) {
+	DWORD_PTR mask = 0;
+	for (int core = first_core; core < first_core + count && core < 64; core++) {
+		mask |= ((DWORD_PTR)1 << core);
+	}
+	if (mask) {
+		SetThreadAffinityMask(GetCurrentThread(), mask);
+	}
+}
 
-			if (idx < 0) break;
-			auto result = predictor.predict(data);
-			m_result_queue_mutex.lock();
-			m_result_queue.push_back({ idx, result });
-			m_result_queue_mutex.unlock();
+AsyncPredictor::AsyncPredictor(const CfgNode &cfg, int num_gpus) : m_put_idx(0), m_get_idx(0), m_put_interrupted(false),
+	m_shutdown(false) {
+	int num_workers = max(num_gpus, 1);
+	int cpu_threads = 0;
+	bool pin = false;
+	if (num_gpus == 0) {
+		int num_cores = max((int)thread::hardware_concurrency(), 1);
+		num_workers = max(cfg["MODEL.CPU_WORKERS"].as<int>(), 1);
+		cpu_threads = cfg["MODEL.THREADS_PER_WORKER"].as<int>();
+		if (cpu_threads <= 0) {
+			cpu_threads = max(num_cores / num_workers, 1);
 		}
-	};
+		pin = cfg["MODEL.CPU_PIN_WORKERS"].as<bool>();
+	}
+
+	int buffer_size = num_workers * 5; // default_buffer_size(), before m_procs is populated
+	m_task_queue = make_unique<BoundedQueue<Task>>(buffer_size);
+	m_results.resize(buffer_size);
+	m_filled.resize(buffer_size, false);
 
-	int num_workers = max(num_gpus, 1);
 	for (int gpuid = 0; gpuid < num_workers; gpuid++) {
 		CfgNode cloned(cfg.clone());
 		cloned.defrost();
@@ -47,56 +52,90 @@ AsyncPredictor::AsyncPredictor(const CfgNode &cfg, int num_gpus) : m_put_idx(0),
 		else {
 			cloned["MODEL.DEVICE"] = "cpu";
 		}
-		m_procs.push_back(make_shared<thread>(_PredictWorker, cfg.node())); // .node() is safe, but not CfgNode
+		// .node() is safe to hand over to another thread, but not CfgNode
+		int first_core = pin ? gpuid * cpu_threads : -1;
+		m_procs.push_back(make_shared<thread>([=](YAML::Node node) { worker(node, cpu_threads, first_core); },
+			cloned.node()));
 	}
 }
 
-void AsyncPredictor::put(torch::Tensor image) {
-	m_task_queue_mutex.lock();
-	m_task_queue.push_back({ ++m_put_idx, image });
-	m_task_queue_mutex.unlock();
+AsyncPredictor::~AsyncPredictor() {
+	shutdown();
 }
 
-InstancesPtr AsyncPredictor::get() {
-	++m_get_idx; // the index needed for this request
-	m_result_rank_mutex.lock();
-	if (!m_result_rank.empty() && std::get<0>(m_result_rank.front()) == m_get_idx) {
-		auto res = std::get<1>(m_result_rank.front());
-		m_result_rank.pop_front();
-		m_result_rank_mutex.unlock();
-		return res;
+void AsyncPredictor::worker(CfgNode cfg, int cpu_threads, int first_core) {
+	if (cpu_threads > 0) {
+		// intra-op settings are per calling thread, so each worker owns a separate pool
+		at::set_num_threads(cpu_threads);
+		if (first_core >= 0) {
+			pin_current_thread(first_core, cpu_threads);
+			// pool threads don't inherit affinity; have the ones this parallel_for runs on pin themselves
+			at::parallel_for(0, cpu_threads, 1, [=](int64_t begin, int64_t end) {
+				pin_current_thread(first_core, cpu_threads);
+			});
+		}
 	}
-	m_result_rank_mutex.unlock();
-
-	while (true) {
-		// make sure the results are returned in the correct order
-		int idx; InstancesPtr res;
-		m_result_queue_mutex.lock();
-		tie(idx, res) = m_result_queue.front();
-		m_result_queue.pop_front();
-		m_result_queue_mutex.unlock();
-		if (idx == m_get_idx) {
-			return res;
+	DefaultPredictor predictor(cfg);
+	Task task;
+	while (m_task_queue->pop(task)) {
+		auto result = predictor.predict(task.image);
+		{
+			std::lock_guard<std::mutex> lk(m_result_mutex);
+			int slot = task.idx % m_results.size();
+			m_results[slot] = result;
+			m_filled[slot] = true;
 		}
-		m_result_rank_mutex.lock();
-		for (auto iter = m_result_rank.begin(); iter != m_result_rank.end(); ++iter) {
-			auto rank = std::get<0>(*iter);
-			if (rank > idx) {
-				m_result_rank.insert(iter, { idx, res });
-			}
+		m_result_ready.notify_all();
+	}
+}
+
+bool AsyncPredictor::put(torch::Tensor image) {
+	int64_t idx;
+	{
+		// a slot in the reorder buffer must be free before the request can go out
+		std::unique_lock<std::mutex> lk(m_result_mutex);
+		m_slot_free.wait(lk, [this]() {
+			return m_put_interrupted || m_put_idx - m_get_idx < (int64_t)m_results.size();
+		});
+		if (m_put_interrupted) {
+			return false;
 		}
-		m_result_rank_mutex.unlock();
+		idx = m_put_idx++;
+	}
+	m_task_queue->push({ idx, image });
+	return true;
+}
+
+void AsyncPredictor::interrupt_put(bool interrupt) {
+	{
+		std::lock_guard<std::mutex> lk(m_result_mutex);
+		m_put_interrupted = interrupt;
 	}
+	m_slot_free.notify_all();
+}
 
-	assert(false);
-	return nullptr;
+InstancesPtr AsyncPredictor::get() {
+	InstancesPtr res;
+	{
+		std::unique_lock<std::mutex> lk(m_result_mutex);
+		assert(m_get_idx < m_put_idx);
+		int slot = m_get_idx % m_results.size();
+		m_result_ready.wait(lk, [=]() { return m_filled[slot]; });
+		res = std::move(m_results[slot]);
+		m_filled[slot] = false;
+		m_get_idx++;
+	}
+	m_slot_free.notify_one();
+	return res;
 }
 
 void AsyncPredictor::shutdown() {
-	m_task_queue_mutex.lock();
-	m_task_queue.push_back({ -1, Tensor() });
-	m_task_queue_mutex.unlock();
+	if (m_shutdown) {
+		return;
+	}
+	m_shutdown = true;
 
+	m_task_queue->close();
 	for (auto t : m_procs) {
 		t->join();
 	}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Predictor.h"
+#include "BoundedQueue.h"
+
+#include <atomic>
 
 namespace Detectron2
 {
@@ -17,33 +20,62 @@ namespace Detectron2
 		/**
 			cfg (CfgNode):
 			num_gpus (int): if 0, will run on CPU
+
+			On CPU, MODEL.CPU_WORKERS predictors run side by side, each with its own intra-op pool of
+			MODEL.THREADS_PER_WORKER threads (0: split all cores evenly). With MODEL.CPU_PIN_WORKERS, worker i
+			asks for cores [i * threads, (i + 1) * threads), so that partitions don't migrate across sockets. This is
+			best-effort: it pins the worker thread and whichever pool threads run one parallel_for, which isn't
+			guaranteed to cover every OpenMP thread that later runs inference. Weights aren't made NUMA-local
+			either, as CPU workers share one read-only mapping of the checkpoint.
 		*/
 		AsyncPredictor(const CfgNode &cfg, int num_gpus = 1);
 
+		~AsyncPredictor();
+
 		int64_t len() const { return m_put_idx - m_get_idx; }
 		int default_buffer_size() const { return m_procs.size() * 5; }
+		int num_workers() const { return m_procs.size(); }
 
-		void put(torch::Tensor image);
+		// blocks while default_buffer_size() requests are already in flight; returns false without putting
+		// image if interrupt_put() was called
+		bool put(torch::Tensor image);
+		// wakes up and fails put() calls, blocked or not, until called again with false, so that a producer
+		// thread can be joined while nobody calls get() any more
+		void interrupt_put(bool interrupt = true);
+		// returns results in the order they were put()
 		InstancesPtr get();
 		InstancesPtr operator()(torch::Tensor image) { return predict(image); }
+		// returns nullptr if interrupt_put() was called
 		virtual InstancesPtr predict(torch::Tensor original_image) override {
-			put(original_image);
+			if (!put(original_image)) {
+				return nullptr;
+			}
 			return get();
 		}
 
 		void shutdown();
 
 	private:
-		std::mutex m_task_queue_mutex;
-		std::condition_variable m_task_queue_ready;
-		std::list<std::tuple<int, torch::Tensor>> m_task_queue;
-		std::mutex m_result_queue_mutex;
-		std::list<std::tuple<int, InstancesPtr>> m_result_queue;
+		struct Task {
+			int64_t idx;
+			torch::Tensor image;
+		};
+
 		std::vector<std::shared_ptr<std::thread>> m_procs;
+		std::unique_ptr<BoundedQueue<Task>> m_task_queue;
+
+		// reorder buffer: result of request idx lands in slot idx % size, so get() never searches or sorts
+		std::mutex m_result_mutex;
+		std::condition_variable m_result_ready;
+		std::condition_variable m_slot_free;
+		std::vector<InstancesPtr> m_results;
+		std::vector<bool> m_filled;
+
+		std::atomic<int64_t> m_put_idx;
+		std::atomic<int64_t> m_get_idx;
+		bool m_put_interrupted;
+		bool m_shutdown;
 
-		int m_put_idx;
-		int m_get_idx;
-		std::mutex m_result_rank_mutex;
-		std::list<std::tuple<int, InstancesPtr>> m_result_rank;
+		void worker(CfgNode cfg, int cpu_threads, int first_core);
 	};
 }
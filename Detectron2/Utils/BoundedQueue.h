@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Detectron2/Base.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Detectron2
+{
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/**
+		Fixed-capacity multi-producer multi-consumer FIFO on a ring buffer. push() blocks while the queue is full,
+		so producers get backpressure instead of growing memory, and pop() sleeps while it is empty instead of
+		spinning. close() wakes everyone up: further pushes fail, and pops drain remaining items before failing.
+	*/
+	template<typename T>
+	class BoundedQueue {
+	public:
+		BoundedQueue(size_t capacity) : m_items(capacity), m_head(0), m_count(0), m_closed(false) {
+			assert(capacity > 0);
+		}
+
+		size_t capacity() const {
+			return m_items.size();
+		}
+		size_t size() const {
+			std::lock_guard<std::mutex> lk(m_mutex);
+			return m_count;
+		}
+
+		// returns false if the queue was closed, in which case item is dropped
+		bool push(T item) {
+			{
+				std::unique_lock<std::mutex> lk(m_mutex);
+				m_not_full.wait(lk, [this]() { return m_closed || m_count < m_items.size(); });
+				if (m_closed) {
+					return false;
+				}
+				m_items[(m_head + m_count) % m_items.size()] = std::move(item);
+				m_count++;
+			}
+			m_not_empty.notify_one();
+			return true;
+		}
+
+		// returns false once the queue is closed and drained
+		bool pop(T &item) {
+			{
+				std::unique_lock<std::mutex> lk(m_mutex);
+				m_not_empty.wait(lk, [this]() { return m_closed || m_count > 0; });
+				if (m_count == 0) {
+					return false;
+				}
+				item = std::move(m_items[m_head]);
+				m_items[m_head] = T();
+				m_head = (m_head + 1) % m_items.size();
+				m_count--;
+			}
+			m_not_full.notify_one();
+			return true;
+		}
+
+		void close() {
+			{
+				std::lock_guard<std::mutex> lk(m_mutex);
+				m_closed = true;
+			}
+			m_not_empty.notify_all();
+			m_not_full.notify_all();
+		}
+
+	private:
+		mutable std::mutex m_mutex;
+		std::condition_variable m_not_empty;
+		std::condition_variable m_not_full;
+		std::vector<T> m_items;
+		size_t m_head;
+		size_t m_count;
+		bool m_closed;
+	};
+}
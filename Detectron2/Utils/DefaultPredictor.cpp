@@ -3,6 +3,7 @@
 
 #include <Detectron2/Utils/Timer.h>
 #include <Detectron2/Data/ResizeShortestEdge.h>
+#include <Detectron2/Data/ResizeTransform.h>
 
 using namespace std;
 using namespace torch;
@@ -24,6 +25,10 @@ DefaultPredictor::DefaultPredictor(const CfgNode &cfg) : m_model(nullptr) {
 		Timer timer("load_checkpoint");
 		m_model->load_checkpoint(cfg["MODEL.WEIGHTS"].as<string>(""), false);
 	}
+	{
+		Timer timer("fuse_batchnorm");
+		m_model->fuse_batchnorm();
+	}
 	m_transform_gen = shared_ptr<TransformGen>(new ResizeShortestEdge(
 		{ cfg["INPUT.MIN_SIZE_TEST"].as<int>(), cfg["INPUT.MIN_SIZE_TEST"].as<int>() },
 		cfg["INPUT.MAX_SIZE_TEST"].as<int>()
@@ -34,26 +39,67 @@ DefaultPredictor::DefaultPredictor(const CfgNode &cfg) : m_model(nullptr) {
 }
 
 InstancesPtr DefaultPredictor::predict(torch::Tensor original_image) {
+	return predict_batch({ original_image })[0];
+}
+
+InstancesList DefaultPredictor::predict_batch(const std::vector<torch::Tensor> &original_images) {
 	torch::NoGradGuard guard; // https://github.com/sphinx-doc/sphinx/issues/4258
 
+	std::vector<DatasetMapperOutput> inputs;
+	inputs.reserve(original_images.size());
+	for (auto &original_image : original_images) {
+		inputs.push_back(preprocess(original_image));
+	}
+	if (inputs.empty()) {
+		return {};
+	}
+	return forward(inputs);
+}
+
+InstancesPtr DefaultPredictor::predict_preprocessed(const DatasetMapperOutput &input) {
+	torch::NoGradGuard guard;
+	return forward({ input })[0];
+}
+
+InstancesList DefaultPredictor::forward(const std::vector<DatasetMapperOutput> &inputs) {
+	InstancesList predictions;
+	{
+		Timer timer("forward");
+		predictions = get<0>(m_model->forward(inputs));
+	}
+	assert(predictions.size() == inputs.size());
+	return predictions;
+}
+
+DatasetMapperOutput DefaultPredictor::preprocess(torch::Tensor original_image) {
+	auto height = original_image.size(0);
+	auto width = original_image.size(1);
+	auto transform = m_transform_gen->get_transform(original_image);
+
+	// On CPU the model converts, resizes, normalizes and pads the BGR frame itself in one pass
+	auto resize = dynamic_pointer_cast<ResizeTransform>(transform);
+	if (m_model->device().is_cpu() && original_image.dtype() == torch::kUInt8 && original_image.size(-1) == 3 &&
+		(!resize || resize->interp() == Transform::kBILINEAR)) {
+		DatasetMapperOutput input;
+		input.image = original_image;
+		input.raw_resize = make_shared<ImageSize>(resize ?
+			ImageSize{ resize->new_h(), resize->new_w() } : ImageSize{ (int)height, (int)width });
+		input.height = make_shared<int>(height);
+		input.width = make_shared<int>(width);
+		return input;
+	}
+
 	// Apply pre-processing to image.
 	if (m_input_format == "RGB") {
 		// whether the model expects BGR inputs or RGB
 		original_image = torch::flip(original_image, { -1 });
 	}
-	auto height = original_image.size(0);
-	auto width = original_image.size(1);
-	auto image = m_transform_gen->get_transform(original_image)->apply_image(original_image);
+	auto image = transform->apply_image(original_image);
 	image = image.to(torch::kFloat32).permute({ 2, 0, 1 });
 
-	std::vector<DatasetMapperOutput> inputs(1);
-	inputs[0].image = image;
-	inputs[0].height = make_shared<int>(height);
-	inputs[0].width = make_shared<int>(width);
-	InstancesPtr predictions;
-	{
-		Timer timer("forward");
-		predictions = get<0>(m_model->forward(inputs))[0];
-	}
-	return predictions;
+	DatasetMapperOutput input;
+	input.image = image;
+	input.height = make_shared<int>(height);
+	input.width = make_shared<int>(width);
+	return input;
 }
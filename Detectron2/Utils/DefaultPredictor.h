@@ -52,11 +52,31 @@ namespace Detectron2
 		*/
 		virtual InstancesPtr predict(torch::Tensor original_image) override;
 
+		/**
+			Same as predict(), but runs all images through a single forward pass. Each image is
+			resized by its own transform, then they are padded together into one batch.
+
+		Args:
+			original_images (list[np.ndarray]): images of shape (H, W, C) (in BGR order).
+
+		Returns:
+			predictions (list[dict]):
+				the output of the model for each image, in the same order as inputs.
+		*/
+		virtual InstancesList predict_batch(const std::vector<torch::Tensor> &original_images);
+
+		// predict() split in two, so that a pipeline can preprocess the next image while this one runs the model:
+		// preprocess() converts one BGR image into model input, applying channel flip and resizing
+		DatasetMapperOutput preprocess(torch::Tensor original_image);
+		InstancesPtr predict_preprocessed(const DatasetMapperOutput &input);
+
 	protected:
 		CfgNode m_cfg;
 		MetaArch m_model;
 		Metadata m_metadata;
 		std::shared_ptr<TransformGen> m_transform_gen;
 		std::string m_input_format;
+
+		InstancesList forward(const std::vector<DatasetMapperOutput> &inputs);
 	};
 }
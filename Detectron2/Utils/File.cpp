@@ -83,8 +83,8 @@ File::File(const string &fullpath, bool read) : m_filename(fullpath), m_file(nul
 	Verify(res == 0);
 }
 
-void File::Seek(int offset) {
-	int res = fseek(m_file, offset, SEEK_SET);
+void File::Seek(int64_t offset) {
+	int res = _fseeki64(m_file, offset, SEEK_SET);
 	Verify(res == 0);
 }
 
@@ -148,3 +148,38 @@ void File::Verify(bool expr) {
 		verify(false);
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile(const std::string &fullpath) :
+	m_filename(fullpath), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0) {
+	m_file = CreateFile(m_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	verify(m_file != INVALID_HANDLE_VALUE);
+
+	LARGE_INTEGER size;
+	verify(GetFileSizeEx(m_file, &size));
+	m_size = size.QuadPart;
+	if (m_size == 0) {
+		return; // zero-length files cannot be mapped
+	}
+
+	// PAGE_WRITECOPY: tensors viewing the mapping can still be modified in place, e.g. when batchnorm is
+	// folded into conv weights, and only the touched pages become private to this process
+	m_mapping = CreateFileMapping(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	verify(m_mapping != nullptr);
+	m_data = (char *)MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0);
+	verify(m_data != nullptr);
+}
+
+MappedFile::~MappedFile() {
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+}
@@ -25,7 +25,7 @@ namespace Detectron2
 		std::string Read();
 		void Write(const std::string &content);
 
-		void Seek(int offset);
+		void Seek(int64_t offset);
 		int ReadInt();
 		void Read(char *buf, size_t total);
 		void Write(const char *buf, size_t total);
@@ -36,4 +36,22 @@ namespace Detectron2
 
 		void Verify(bool expr);
 	};
+
+	// Read-only, copy-on-write memory mapping of a whole file. Pages are shared with other processes mapping
+	// the same file through the OS page cache until written to.
+	class MappedFile {
+	public:
+		MappedFile(const std::string &fullpath);
+		~MappedFile();
+
+		const char *data() const { return m_data; }
+		int64_t size() const { return m_size; }
+
+	private:
+		std::string m_filename;
+		void *m_file;		// HANDLE
+		void *m_mapping;	// HANDLE
+		char *m_data;
+		int64_t m_size;
+	};
 }
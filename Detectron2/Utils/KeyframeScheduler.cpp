@@ -0,0 +1,195 @@
+#include "Base.h"
+#include "KeyframeScheduler.h"
+
+#include <Detectron2/Structures/Boxes.h>
+#include <Detectron2/coco/mask.h>
+
+using namespace std;
+using namespace torch;
+using namespace Detectron2;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// constants
+static const int kTrackingSize = 480;		// longer side of the frames tracking works on
+static const int kThumbnailSize = 64;		// width of the thumbnails compared for change
+static const int kMinPatchSize = 4;			// boxes smaller than this after downscaling aren't followed
+static const int kMinSearchRadius = 8;
+
+static cv::Mat thumbnail(cv::Mat gray) {
+	cv::Mat thumb;
+	cv::resize(gray, thumb, { kThumbnailSize, max(1, kThumbnailSize * gray.rows / gray.cols) }, 0, 0,
+		cv::INTER_AREA);
+	return thumb;
+}
+
+KeyframeScheduler::KeyframeScheduler(const Options &options) :
+	m_options(options), m_keyframes(0), m_propagated(0), m_since_keyframe(0), m_scale(1) {
+}
+
+cv::Mat KeyframeScheduler::tracking_image(cv::Mat frame) {
+	cv::Mat gray;
+	if (frame.channels() == 1) {
+		gray = frame;
+	}
+	else {
+		cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+	}
+	m_scale = 1;
+	int size = max(gray.cols, gray.rows);
+	if (size > kTrackingSize) {
+		cv::Mat small;
+		cv::resize(gray, small, { gray.cols * kTrackingSize / size, gray.rows * kTrackingSize / size }, 0, 0,
+			cv::INTER_AREA);
+		m_scale = (float)small.cols / gray.cols;
+		gray = small;
+	}
+	return gray;
+}
+
+InstancesPtr KeyframeScheduler::propagate(cv::Mat frame) {
+	if (!m_key_instances || m_since_keyframe + 1 >= m_options.interval) {
+		return nullptr;
+	}
+
+	auto gray = tracking_image(frame);
+	cv::Mat diff;
+	cv::absdiff(thumbnail(gray), m_key_thumbnail, diff);
+	if (cv::mean(diff)[0] / 255 > m_options.change_threshold || !track(gray)) {
+		return nullptr;
+	}
+	m_prev_gray = gray;
+	m_since_keyframe++;
+	m_propagated++;
+
+	auto instances = moved_instances();
+	auto predictions = make_shared<Instances>(instances->image_size(), false);
+	predictions->set("instances", instances);
+	return predictions;
+}
+
+void KeyframeScheduler::keyframe(cv::Mat frame, const InstancesPtr &predictions) {
+	m_keyframes++;
+	m_since_keyframe = 0;
+	m_key_instances = nullptr;
+	m_key_masks = Tensor();
+	m_offsets.clear();
+	if (m_options.interval <= 1 || !predictions->has("instances") ||
+		predictions->has("sem_seg") || predictions->has("panoptic_seg")) {
+		return;
+	}
+	auto instances = dynamic_pointer_cast<Instances>(predictions->get("instances"));
+	if (!instances->has("pred_boxes")) {
+		return;
+	}
+
+	m_prev_gray = tracking_image(frame);
+	m_key_thumbnail = thumbnail(m_prev_gray);
+
+	// Instances::to() would drop the fields that aren't tensors, like "pred_masks_rle"
+	SequencePtrMap fields;
+	for (auto &field : instances->get_fields()) {
+		auto tseq = dynamic_pointer_cast<SequenceTensor>(field.second);
+		if (tseq) {
+			fields[field.first] = make_shared<SequenceTensor>(tseq->data().to(torch::kCPU));
+		}
+		else {
+			fields[field.first] = field.second;
+		}
+	}
+	m_key_instances = make_shared<Instances>(instances->image_size(), std::move(fields));
+	m_offsets.assign(m_key_instances->size(), cv::Point2f(0, 0));
+
+	if (m_key_instances->has("pred_masks_rle") && m_key_instances->size() > 0) {
+		auto &rles = m_key_instances->getVec<pycocotools::MaskObject>("pred_masks_rle");
+		m_key_masks = pycocotools::decode(rles).permute({ 2, 0, 1 });
+	}
+}
+
+bool KeyframeScheduler::track(cv::Mat gray) {
+	auto boxes = m_key_instances->getTensor("pred_boxes").to(torch::kFloat32);
+	auto box_data = boxes.accessor<float, 2>();
+	cv::Rect bounds(0, 0, gray.cols, gray.rows);
+
+	auto offsets = m_offsets;
+	for (int i = 0; i < offsets.size(); i++) {
+		auto &offset = offsets[i];
+		// where the box was in the previous frame
+		cv::Rect box(
+			cv::Point(cvRound((box_data[i][0] + offset.x) * m_scale), cvRound((box_data[i][1] + offset.y) * m_scale)),
+			cv::Point(cvRound((box_data[i][2] + offset.x) * m_scale), cvRound((box_data[i][3] + offset.y) * m_scale)));
+		box &= bounds;
+		if (box.width < kMinPatchSize || box.height < kMinPatchSize) {
+			continue; // too small, or out of the frame, to be followed
+		}
+		auto patch = m_prev_gray(box);
+		cv::Scalar mean, stddev;
+		cv::meanStdDev(patch, mean, stddev);
+		if (stddev[0] < 1) {
+			continue; // flat, so there's nothing to match
+		}
+
+		int radius = max(kMinSearchRadius, max(box.width, box.height) / 4);
+		cv::Rect window(box.x - radius, box.y - radius, box.width + 2 * radius, box.height + 2 * radius);
+		window &= bounds;
+		cv::Mat scores;
+		cv::matchTemplate(gray(window), patch, scores, cv::TM_CCOEFF_NORMED);
+		double score;
+		cv::Point loc;
+		cv::minMaxLoc(scores, nullptr, &score, nullptr, &loc);
+		if (score < m_options.min_track_score) {
+			return false;
+		}
+		offset.x += (window.x + loc.x - box.x) / m_scale;
+		offset.y += (window.y + loc.y - box.y) / m_scale;
+	}
+	m_offsets = std::move(offsets);
+	return true;
+}
+
+InstancesPtr KeyframeScheduler::moved_instances() const {
+	int n = m_offsets.size();
+	auto image_size = m_key_instances->image_size();
+	SequencePtrMap fields = m_key_instances->get_fields();
+	if (n == 0) {
+		return make_shared<Instances>(image_size, std::move(fields));
+	}
+	auto offsets = torch::from_blob((void*)m_offsets.data(), { n, 2 }, torch::kFloat32).clone();
+
+	Boxes boxes(m_key_instances->getTensor("pred_boxes") + offsets.repeat({ 1, 2 }));
+	boxes.clip(image_size);
+	fields["pred_boxes"] = make_shared<SequenceTensor>(boxes.tensor());
+
+	if (m_key_instances->has("pred_keypoints")) {
+		auto keypoints = m_key_instances->getTensor("pred_keypoints").clone(); // (N, K, 3)
+		keypoints.narrow(2, 0, 2).add_(offsets.unsqueeze(1));
+		fields["pred_keypoints"] = make_shared<SequenceTensor>(keypoints);
+	}
+	if (m_key_instances->has("pred_masks")) {
+		fields["pred_masks"] = make_shared<SequenceTensor>(moved_masks(m_key_instances->getTensor("pred_masks")));
+	}
+	if (m_key_masks.defined()) {
+		auto rles = make_shared<SequenceVec<pycocotools::MaskObject>>();
+		rles->data() = pycocotools::encode(moved_masks(m_key_masks).permute({ 1, 2, 0 }));
+		fields["pred_masks_rle"] = rles;
+	}
+	// "pred_masks_local" is relative to its box, so it moves along as is
+	return make_shared<Instances>(image_size, std::move(fields));
+}
+
+torch::Tensor KeyframeScheduler::moved_masks(const torch::Tensor &masks) const {
+	auto moved = torch::zeros_like(masks);
+	int h = masks.size(1);
+	int w = masks.size(2);
+	for (int i = 0; i < m_offsets.size(); i++) {
+		int dx = cvRound(m_offsets[i].x);
+		int dy = cvRound(m_offsets[i].y);
+		int x0 = max(0, dx), x1 = min(w, w + dx);
+		int y0 = max(0, dy), y1 = min(h, h + dy);
+		if (x0 < x1 && y0 < y1) {
+			moved.index_put_({ i, Slice(y0, y1), Slice(x0, x1) },
+				masks.index({ i, Slice(y0 - dy, y1 - dy), Slice(x0 - dx, x1 - dx) }));
+		}
+	}
+	return moved;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Detectron2/Structures/Instances.h>
+
+namespace Detectron2
+{
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/**
+		Decides which video frames go through the detector, and carries the instance predictions of the last
+		keyframe over to the frames in between.
+
+		A frame becomes a keyframe when options.interval frames have passed since the last one, when it differs
+		from the last keyframe by more than options.change_threshold, or when one of the instances is lost.
+		Between keyframes, every box follows the best match of its patch from the previous frame within a small
+		window (normalized cross correlation on a downscaled grayscale frame). Masks and keypoints move with
+		their boxes. Only "instances" predictions are propagated, so semantic and panoptic segmentation still
+		run the detector on every frame.
+
+		Frames must come in video order and from one thread.
+	*/
+	class KeyframeScheduler {
+	public:
+		struct Options {
+			int interval = 1;				// run the detector at least every interval frames, 1: on every frame
+			float change_threshold = 0.1;	// mean absolute change of a thumbnail since the keyframe, in [0, 1]
+			float min_track_score = 0.6;	// correlation below which an instance counts as lost
+		};
+
+		KeyframeScheduler(const Options &options);
+
+		/**
+			frame: BGR frame, following the last one given to propagate() or keyframe().
+
+			Returns the keyframe's predictions moved to frame, or nullptr if frame has to be a keyframe. It is
+			then up to the caller to run the detector and to hand its predictions to keyframe().
+		*/
+		InstancesPtr propagate(cv::Mat frame);
+
+		// Makes frame the new keyframe, with the detector's predictions for it.
+		void keyframe(cv::Mat frame, const InstancesPtr &predictions);
+
+		int64_t keyframes() const { return m_keyframes; }
+		int64_t propagated() const { return m_propagated; }
+
+	private:
+		Options m_options;
+		int64_t m_keyframes;
+		int64_t m_propagated;
+
+		int m_since_keyframe;
+		cv::Mat m_key_thumbnail;			// for measuring change since the keyframe
+		cv::Mat m_prev_gray;				// downscaled by m_scale, for tracking
+		float m_scale;
+
+		InstancesPtr m_key_instances;		// on CPU, nullptr when there's nothing to propagate
+		torch::Tensor m_key_masks;			// (N, H, W) uint8, decoded "pred_masks_rle"
+		std::vector<cv::Point2f> m_offsets;	// motion of each instance since the keyframe, in image pixels
+
+		cv::Mat tracking_image(cv::Mat frame);
+		// false if an instance is lost
+		bool track(cv::Mat gray);
+		InstancesPtr moved_instances() const;
+		// masks: (N, H, W), moved by whole pixels
+		torch::Tensor moved_masks(const torch::Tensor &masks) const;
+	};
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Detectron2/Base.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Detectron2
+{
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+	/**
+		Single-slot mailbox for live sources: put() never blocks and overwrites whatever the consumers haven't
+		taken yet, counting it as dropped, and take() waits for the newest item. Unlike BoundedQueue, a slow
+		consumer makes the producer skip items instead of falling further and further behind. close() works
+		the same way as BoundedQueue::close().
+	*/
+	template<typename T>
+	class LatestSlot {
+	public:
+		LatestSlot() : m_full(false), m_closed(false), m_dropped(0) {}
+
+		int64_t dropped() const {
+			std::lock_guard<std::mutex> lk(m_mutex);
+			return m_dropped;
+		}
+
+		// returns false if the slot was closed, in which case item is dropped
+		bool put(T item) {
+			{
+				std::lock_guard<std::mutex> lk(m_mutex);
+				if (m_closed) {
+					return false;
+				}
+				if (m_full) {
+					m_dropped++;
+				}
+				m_item = std::move(item);
+				m_full = true;
+			}
+			m_not_empty.notify_one();
+			return true;
+		}
+
+		// returns false once the slot is closed and drained
+		bool take(T &item) {
+			std::unique_lock<std::mutex> lk(m_mutex);
+			m_not_empty.wait(lk, [this]() { return m_closed || m_full; });
+			if (!m_full) {
+				return false;
+			}
+			item = std::move(m_item);
+			m_item = T();
+			m_full = false;
+			return true;
+		}
+
+		void close() {
+			{
+				std::lock_guard<std::mutex> lk(m_mutex);
+				m_closed = true;
+			}
+			m_not_empty.notify_all();
+		}
+
+	private:
+		mutable std::mutex m_mutex;
+		std::condition_variable m_not_empty;
+		T m_item;
+		bool m_full;
+		bool m_closed;
+		int64_t m_dropped;
+	};
+}
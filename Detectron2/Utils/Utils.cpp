@@ -66,66 +66,116 @@ std::string Detectron2::replace_all(const std::string &s, const std::string &src
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // image functions
 
-cv::Mat Detectron2::image_to_mat(const torch::Tensor &t) {
+namespace {
+	// Lets cv::Mat headers share the storage of a tensor: the UMatData of such a Mat holds a reference to the
+	// tensor, which is dropped once the last Mat using it is released. Reallocations go to the std allocator.
+	class TensorMatAllocator : public cv::MatAllocator {
+	public:
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 2)
+		typedef cv::AccessFlag AccessFlag;
+#else
+		typedef int AccessFlag;
+#endif
+
+		cv::Mat wrap(const torch::Tensor &t, int type) const {
+			int rows = t.size(0);
+			int cols = t.size(1);
+			size_t step = t.stride(0) * t.element_size();
+			cv::Mat ret(rows, cols, type, t.data_ptr(), step);
+
+			auto u = new cv::UMatData(this);
+			u->data = u->origdata = ret.data;
+			u->size = step * rows;
+			u->userdata = new torch::Tensor(t);
+			u->refcount = 1;
+			ret.u = u;
+			ret.allocator = const_cast<TensorMatAllocator*>(this);
+			return ret;
+		}
+
+		virtual cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+			AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+			return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+		}
+		virtual bool allocate(cv::UMatData *data, AccessFlag accessflags,
+			cv::UMatUsageFlags usageFlags) const override {
+			return cv::Mat::getStdAllocator()->allocate(data, accessflags, usageFlags);
+		}
+		virtual void deallocate(cv::UMatData *u) const override {
+			if (u) {
+				delete (torch::Tensor*)u->userdata;
+				delete u;
+			}
+		}
+	};
+}
+
+cv::Mat Detectron2::image_to_mat(const torch::Tensor &image) {
+	static TensorMatAllocator allocator;
+
 	int channel = 1;
-	if (t.dim() != 2) {
-		assert(t.dim() == 3);
-		channel = t.size(2);
+	if (image.dim() != 2) {
+		assert(image.dim() == 3);
+		channel = image.size(2);
 		assert(channel >= 1 && channel <= 4);
 	}
 
-	int type, size;
-	if (t.dtype() == torch::kFloat32) {
+	int type;
+	if (image.dtype() == torch::kFloat32) {
 		type = vector<int>{ CV_32FC1, CV_32FC2, CV_32FC3, CV_32FC4 }[channel - 1];
-		size = sizeof(float);
 	}
 	else {
-		assert(t.dtype() == torch::kUInt8);
+		assert(image.dtype() == torch::kUInt8);
 		type = vector<int>{ CV_8UC1, CV_8UC2, CV_8UC3, CV_8UC4 }[channel - 1];
-		size = sizeof(unsigned char);
 	}
 
-	cv::Mat ret((int)t.size(0), (int)t.size(1), type);
-	::memcpy(ret.data, t.cpu().data_ptr(), t.numel() * size);
-	return ret;
+	auto t = image.cpu();
+	if (t.numel() == 0) {
+		return cv::Mat((int)t.size(0), (int)t.size(1), type);
+	}
+	// Mat rows can have any step, but inside a row pixels and their channels have to be packed
+	bool packed = (t.dim() == 2 || (t.stride(2) == 1 && t.stride(1) == channel)) &&
+		(t.dim() == 3 || t.stride(1) == 1) &&
+		t.stride(0) >= t.size(1) * channel;
+	if (!packed) {
+		t = t.contiguous();
+	}
+	return allocator.wrap(t, type);
 }
 
 torch::Tensor Detectron2::mat_to_tensor(const cv::Mat &mat) {
-	assert(mat.isContinuous());
-
-	static map<int, std::tuple<torch::ScalarType, size_t, int>> types = {
-		{ CV_32S,	{ torch::kInt32,	sizeof(int32_t), 1 }},
-		{ CV_8U,	{ torch::kUInt8,	sizeof(char),	 1 }},
-		{ CV_8UC3,	{ torch::kUInt8,	sizeof(char),	 3 }},
-		{ CV_8UC4,	{ torch::kUInt8,	sizeof(char),	 4 }},
+	static map<int, torch::ScalarType> types = {
+		{ CV_8U,	torch::kUInt8 },
+		{ CV_8S,	torch::kInt8 },
+		{ CV_16S,	torch::kInt16 },
+		{ CV_32S,	torch::kInt32 },
+		{ CV_32F,	torch::kFloat32 },
+		{ CV_64F,	torch::kFloat64 },
 	};
-	auto tt = mat.type();
-	assert(types.find(tt) != types.end());
-	torch::ScalarType type; size_t size; int channel;
-	tie(type, size, channel) = types[tt];
-
-	vector<int64_t> shape;
-	for (int i = 0; i < mat.dims; i++) shape.push_back(mat.size[i]);
+	assert(types.find(mat.depth()) != types.end());
+	auto type = types[mat.depth()];
+
+	// the tensor keeps a reference on the Mat buffer, unless there is no refcount to keep (user data)
+	auto holder = new cv::Mat(mat.u ? mat : mat.clone());
+	int channel = holder->channels();
+	size_t elem = holder->elemSize1();
+
+	vector<int64_t> shape, strides;
+	for (int i = 0; i < holder->dims; i++) {
+		shape.push_back(holder->size[i]);
+		strides.push_back(holder->step[i] / elem);
+	}
 	if (channel > 1) {
 		shape.push_back(channel);
+		strides.push_back(1);
 	}
-	int count = mat.size().area() * channel * size;
-
-	auto p = malloc(count);
-	memcpy(p, mat.data, count);
-	return torch::from_blob(p, shape, torch::Deleter(free), type);
+	return torch::from_blob(holder->data, shape, strides, [holder](void*) { delete holder; }, type);
 }
 
 torch::Tensor Detectron2::image_to_tensor(const cv::Mat &mat) {
-	assert(mat.isContinuous());
 	assert(mat.type() == CV_8UC3 || mat.type() == CV_8UC4);
 	assert(mat.dims == 2);
-
-	int channel = mat.channels();
-	int count = mat.size().area() * channel;
-	auto p = malloc(count);
-	memcpy(p, (unsigned char*)mat.data, count);
-	return torch::from_blob(p, { mat.size[0], mat.size[1], channel }, torch::Deleter(free), torch::kUInt8);
+	return mat_to_tensor(mat);
 }
 
 torch::Tensor Detectron2::read_image(const std::string &pathname, const std::string &format) {
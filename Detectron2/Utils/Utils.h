@@ -16,6 +16,11 @@ namespace Detectron2
 	std::string replace_all(const std::string &s, const std::string &src, const std::string &target);
 
 	// image functions
+	//
+	// These conversions share buffers instead of copying: a tensor from a Mat references the Mat's refcounted
+	// data, and a Mat from a tensor references the tensor's storage. Either side keeps the buffer alive, but
+	// writes through one are seen by the other, e.g. reading the next video frame into the same Mat. A copy
+	// is only made when the layout has to change (non-packed tensor strides, Mat without refcount, GPU tensor).
 	torch::Tensor mat_to_tensor(const cv::Mat &mat);
 	cv::Mat image_to_mat(const torch::Tensor &t);
 	torch::Tensor image_to_tensor(const cv::Mat &mat);
@@ -17,6 +17,11 @@ void VideoAnalyzer::on_instance_predictions(cv::Mat frame, const InstancesPtr &p
 	const std::vector<std::string> &keypoint_names) {
 }
 
+void VideoAnalyzer::on_instance_predictions(cv::Mat frame, const InstancesPtr &predictions,
+	const std::vector<std::string> &keypoint_names, bool propagated) {
+	on_instance_predictions(frame, predictions, keypoint_names);
+}
+
 void VideoAnalyzer::on_sem_seg(cv::Mat frame, const torch::Tensor &sem_seg) {
 }
 
@@ -15,6 +15,10 @@ namespace Detectron2
 
 		virtual void on_instance_predictions(cv::Mat frame, const InstancesPtr &predictions,
 			const std::vector<std::string> &keypoint_names);
+		// propagated: predictions were carried over from the last keyframe by KeyframeScheduler, rather than
+		// coming from the detector. Calls the overload above by default.
+		virtual void on_instance_predictions(cv::Mat frame, const InstancesPtr &predictions,
+			const std::vector<std::string> &keypoint_names, bool propagated);
 		virtual void on_sem_seg(cv::Mat frame, const torch::Tensor &sem_seg);
 		virtual void on_panoptic_seg_predictions(cv::Mat frame, const torch::Tensor &panoptic_seg,
 			const std::vector<SegmentInfo> &segments_info);
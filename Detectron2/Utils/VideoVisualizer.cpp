@@ -28,19 +28,11 @@ VisImage VideoVisualizer::draw_instance_predictions(cv::Mat frame, const Instanc
 	Tensor classes; if (predictions->has("pred_classes")) classes = predictions->getTensor("pred_classes");
 	Tensor keypoints; if (predictions->has("pred_keypoints")) keypoints = predictions->getTensor("pred_keypoints");
 
-	vector<shared_ptr<GenericMask>> masks;
-	if (predictions->has("pred_masks")) {
-		auto t_masks = predictions->getTensor("pred_masks");
-		int count = t_masks.size(0);
-		masks.reserve(count);
-		for (int i = 0; i < count; i++) {
-			auto mask = make_shared<GenericMask>(t_masks[i], frame_visualizer.height(), frame_visualizer.width());
-			masks.push_back(mask);
-		}
-		// mask IOU is not yet enabled
-		// masks_rles = mask_util.encode(np.asarray(masks.permute(1, 2, 0), order="F"))
-		// assert len(masks_rles) == num_instances
-	}
+	auto masks = Visualizer::_convert_instance_masks(predictions, frame_visualizer.height(),
+		frame_visualizer.width());
+	// mask IOU is not yet enabled
+	// masks_rles = mask_util.encode(np.asarray(masks.permute(1, 2, 0), order="F"))
+	// assert len(masks_rles) == num_instances
 
 	vector<shared_ptr<_DetectedInstance>> detected;
 	detected.reserve(num_instances);
@@ -58,7 +50,7 @@ VisImage VideoVisualizer::draw_instance_predictions(cv::Mat frame, const Instanc
 	float alpha = 0.5;
 	if (m_instance_mode == ColorMode::kIMAGE_BW) {
 		// any() returns uint8 tensor
-		frame_visualizer.set_grayscale_image(predictions->getTensor("pred_masks").any(0) > 0);
+		frame_visualizer.set_grayscale_image(GenericMask::toCocoMask(masks).any(0) > 0);
 		alpha = 0.3;
 	}
 
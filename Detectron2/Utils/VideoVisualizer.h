@@ -21,7 +21,7 @@ namespace Detectron2
 				frame (ndarray): an RGB image of shape (H, W, C), in the range [0, 255].
 				predictions (Instances): the output of an instance detection/segmentation
 					model. Following fields will be used to draw:
-					"pred_boxes", "pred_classes", "scores", "pred_masks" (or "pred_masks_rle").
+					"pred_boxes", "pred_classes", "scores", "pred_masks" (or "pred_masks_local", "pred_masks_rle").
 
 			Returns:
 				output (VisImage): image object with visualizations.
@@ -62,6 +62,36 @@ Visualizer::Visualizer(const torch::Tensor &img_rgb, Metadata metadata, float sc
 {
 }
 
+std::vector<std::shared_ptr<GenericMask>> Visualizer::_convert_instance_masks(const InstancesPtr &predictions,
+	int height, int width) {
+	vector<shared_ptr<GenericMask>> masks;
+	if (predictions->has("pred_masks")) {
+		auto t_masks = predictions->getTensor("pred_masks");
+		int count = t_masks.size(0);
+		masks.reserve(count);
+		for (int i = 0; i < count; i++) {
+			masks.push_back(make_shared<GenericMask>(t_masks[i], height, width));
+		}
+	}
+	else if (predictions->has("pred_masks_local")) {
+		auto t_masks = predictions->getTensor("pred_masks_local");
+		auto boxes = predictions->getTensor("pred_boxes");
+		int count = t_masks.size(0);
+		masks.reserve(count);
+		for (int i = 0; i < count; i++) {
+			masks.push_back(make_shared<GenericMask>(t_masks[i], boxes[i], height, width));
+		}
+	}
+	else if (predictions->has("pred_masks_rle")) {
+		auto &rles = predictions->getVec<mask_util::MaskObject>("pred_masks_rle");
+		masks.reserve(rles.size());
+		for (auto &rle : rles) {
+			masks.push_back(make_shared<GenericMask>(rle, height, width));
+		}
+	}
+	return masks;
+}
+
 void Visualizer::set_grayscale_image(const torch::Tensor &img) {
 	m_output.img() = _create_grayscale_image(img);
 }
@@ -83,8 +113,10 @@ VisImage Visualizer::draw_instance_predictions(const InstancesPtr &predictions)
 		alpha = 0.8;
 	}
 
+	auto masks = _convert_instance_masks(predictions, m_output.height(), m_output.width());
 	if (m_instance_mode == ColorMode::kIMAGE_BW) {
-		set_grayscale_image(predictions->getTensor("pred_masks").any(0) > 0);
+		set_grayscale_image(masks.empty() ? torch::zeros({ m_output.height(), m_output.width() }, torch::kBool) :
+			GenericMask::toCocoMask(masks).any(0) > 0);
 		alpha = 0.3;
 	}
 
@@ -92,16 +124,6 @@ VisImage Visualizer::draw_instance_predictions(const InstancesPtr &predictions)
 	Tensor scores; if (predictions->has("scores")) scores = predictions->getTensor("scores");
 	auto labels = _create_text_labels(classes, scores, m_metadata->thing);
 	Tensor keypoints; if (predictions->has("pred_keypoints")) keypoints = predictions->getTensor("pred_keypoints");
-	vector<shared_ptr<GenericMask>> masks;
-	if (predictions->has("pred_masks")) {
-		auto t_masks = predictions->getTensor("pred_masks");
-		int count = t_masks.size(0);
-		masks.reserve(count);
-		for (int i = 0; i < count; i++) {
-			auto mask = make_shared<GenericMask>(t_masks[i], m_output.height(), m_output.width());
-			masks.push_back(mask);
-		}
-	}
 
 	overlay_instances(boxes, labels, masks, keypoints, colors, alpha);
 	return m_output;
@@ -25,6 +25,14 @@ namespace Detectron2
 		static std::vector<std::string> _create_text_labels(const torch::Tensor &classes, const torch::Tensor &scores,
 			const std::vector<ClassColor> &class_colors = {});
 
+		/**
+			Wraps the instance masks of predictions into GenericMask, whichever form MODEL.MASK_OUTPUT
+			returned them in: "pred_masks", "pred_masks_local" (with "pred_boxes") or "pred_masks_rle".
+			Compact forms are only expanded to (height, width) when a mask is first drawn.
+		*/
+		static std::vector<std::shared_ptr<GenericMask>> _convert_instance_masks(const InstancesPtr &predictions,
+			int height, int width);
+
 	public:
 		/**
 			img_rgb: a numpy array of shape (H, W, C), where H and W correspond to
@@ -54,7 +62,7 @@ namespace Detectron2
 			Args:
 				predictions (Instances): the output of an instance detection/segmentation
 					model. Following fields will be used to draw:
-					"pred_boxes", "pred_classes", "scores", "pred_masks" (or "pred_masks_rle").
+					"pred_boxes", "pred_classes", "scores", "pred_masks" (or "pred_masks_local", "pred_masks_rle").
 
 			Returns:
 				output (VisImage): image object with visualizations.
@@ -144,5 +144,6 @@ void cvCanvas::DrawText(int x, int y, const std::string &text, const DrawTextOpt
 
 void cvCanvas::DrawImage(const torch::Tensor &img) {
 	assert(img.dim() == 3 && img.size(2) == 4);
-	m_canvas = image_to_mat(img.to(torch::kUInt8));
+	// the canvas is drawn on, so it must not share the caller's tensor
+	m_canvas = image_to_mat(img.to(torch::kUInt8, false, true));
 }
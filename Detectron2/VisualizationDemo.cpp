@@ -4,11 +4,16 @@
 #include <Detectron2/Data/BuiltinDataset.h>
 #include <Detectron2/Data/MetadataCatalog.h>
 #include <Detectron2/Utils/AsyncPredictor.h>
+#include <Detectron2/Utils/BoundedQueue.h>
 #include <Detectron2/Utils/DefaultPredictor.h>
+#include <Detectron2/Utils/LatestSlot.h>
 #include <Detectron2/Utils/Utils.h>
 #include <Detectron2/Utils/VideoVisualizer.h>
 #include <Detectron2/Utils/Timer.h>
 
+#include <chrono>
+#include <thread>
+
 using namespace std;
 using namespace torch;
 using namespace Detectron2;
@@ -84,7 +89,7 @@ void VisualizationDemo::start(const Options &options) {
 			cv::namedWindow(WINDOW_NAME, cv::WINDOW_NORMAL);
 			cv::imshow(WINDOW_NAME, vis);
 			return cv::waitKey(1) != 27; // esc to quit
-		});
+		}, options.realtime, options.keyframes);
 		cam.release();
 		cv::destroyAllWindows();
 	}
@@ -123,7 +128,7 @@ void VisualizationDemo::start(const Options &options) {
 				cv::imshow(filename, vis_frame);
 				return cv::waitKey(1) != 27; // esc to quit
 			}
-		});
+		}, options.realtime, options.keyframes);
 		video.release();
 		if (!options.output.empty()) {
 			output_file.release();
@@ -179,14 +184,15 @@ std::tuple<InstancesPtr, VisImage> VisualizationDemo::run_on_image(torch::Tensor
 	return { predictions, vis_output };
 }
 
-void VisualizationDemo::run_on_video(cv::VideoCapture &video, function<bool(cv::Mat)> vis_frame_processor) {
+void VisualizationDemo::run_on_video(cv::VideoCapture &video, function<bool(cv::Mat)> vis_frame_processor,
+	bool realtime, const KeyframeScheduler::Options &keyframes) {
 	VideoVisualizer video_visualizer(m_metadata, m_instance_mode);
 
-	auto process_predictions = [&](cv::Mat &frame, InstancesPtr predictions,
-		function<bool(cv::Mat)> vis_frame_processor){
-		Timer timer("process_predictions");
+	auto process_predictions = [&](VideoFrame &f) {
+		auto &predictions = f.predictions;
 
-		cv::cvtColor(frame, frame, cv::COLOR_RGB2BGR);
+		cv::Mat frame;
+		cv::cvtColor(f.frame, frame, cv::COLOR_RGB2BGR);
 		VisImage vis_frame;
 		if (predictions->has("panoptic_seg")) {
 			auto panoptic_seg = dynamic_pointer_cast<PanopticSegment>(predictions->get("panoptic_seg"));
@@ -207,24 +213,21 @@ void VisualizationDemo::run_on_video(cv::VideoCapture &video, function<bool(cv::
 		}
 
 		// Converts Matplotlib RGB format to OpenCV BGR format
-		cv::Mat vis_frame_out;
-		cv::cvtColor(image_to_mat(vis_frame.get_image()), vis_frame_out, cv::COLOR_RGB2BGR);
-		return vis_frame_processor(vis_frame_out);
+		cv::cvtColor(image_to_mat(vis_frame.get_image()), f.vis_frame, cv::COLOR_RGB2BGR);
 	};
 
-	while (video.isOpened()) {
-		cv::Mat frame;
-		if (!video.read(frame) ||
-			!process_predictions(frame, m_predictor->predict(image_to_tensor(frame)), vis_frame_processor)) {
-			break;
-		}
-	}
+	run_pipeline(video, process_predictions, [&](VideoFrame &f) {
+		return vis_frame_processor(f.vis_frame);
+	}, realtime, keyframes);
 }
 
-void VisualizationDemo::analyze_on_video(cv::VideoCapture &video, VideoAnalyzer &analyzer) {
-	auto process_predictions = [&](cv::Mat &frame, InstancesPtr predictions) {
+void VisualizationDemo::analyze_on_video(cv::VideoCapture &video, VideoAnalyzer &analyzer, bool realtime,
+	const KeyframeScheduler::Options &keyframes) {
+	auto process_predictions = [&](VideoFrame &f) {
 			Timer timer("analyze_predictions");
 
+			auto &frame = f.frame;
+			auto &predictions = f.predictions;
 			if (predictions->has("panoptic_seg")) {
 				auto panoptic_seg = dynamic_pointer_cast<PanopticSegment>(predictions->get("panoptic_seg"));
 				analyzer.on_panoptic_seg_predictions(
@@ -234,19 +237,235 @@ void VisualizationDemo::analyze_on_video(cv::VideoCapture &video, VideoAnalyzer
 			else if (predictions->has("instances")) {
 				auto instances = dynamic_pointer_cast<Instances>(predictions->get("instances"));
 				instances->to(m_cpu_device);
-				analyzer.on_instance_predictions(frame, instances, m_metadata->keypoint_names);
+				analyzer.on_instance_predictions(frame, instances, m_metadata->keypoint_names, f.propagated);
 			}
 			else if (predictions->has("sem_seg")) {
 				auto sem_seq = predictions->getTensor("sem_seg").argmax(0).to(m_cpu_device);
 				analyzer.on_sem_seg(frame, sem_seq);
 			}
+			return true;
 	};
 
-	while (video.isOpened()) {
-		cv::Mat frame;
-		if (!video.read(frame)) {
+	run_pipeline(video, nullptr, process_predictions, realtime, keyframes);
+}
+
+namespace {
+	// how busy one pipeline stage was, and how full its output queue ran
+	struct PipelineStage {
+		std::string name;
+		int64_t frames = 0;
+		double busy_ms = 0;
+		int64_t queued = 0;		// sum of output queue sizes after each push
+	};
+}
+
+void VisualizationDemo::run_pipeline(cv::VideoCapture &video, std::function<void(VideoFrame&)> visualize,
+	std::function<bool(VideoFrame&)> consumer, bool realtime, const KeyframeScheduler::Options &keyframes) {
+	typedef shared_ptr<VideoFrame> FramePtr;
+	typedef BoundedQueue<FramePtr> FrameQueue;
+	static const int kQueueSize = 4;
+	// in real-time mode, frames shouldn't wait anywhere longer than necessary
+	size_t queue_size = realtime ? 1 : kQueueSize;
+
+	auto default_predictor = dynamic_pointer_cast<DefaultPredictor>(m_predictor);
+	auto async_predictor = dynamic_pointer_cast<AsyncPredictor>(m_predictor);
+
+	// each stage is one thread, so FIFO queues keep frames in order
+	list<PipelineStage> stages;
+	list<FrameQueue> queues;
+	LatestSlot<FramePtr> latest;
+	vector<thread> threads;
+	auto t0 = chrono::steady_clock::now();
+	auto elapsed_ms = [](chrono::steady_clock::time_point since) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
+	};
+
+	// source stage, decoding into a new Mat every frame, since tensors made from it share its buffer
+	FrameQueue *out = nullptr;
+	if (!realtime) {
+		queues.emplace_back(queue_size);
+		out = &queues.back();
+	}
+	stages.push_back({ "decode" });
+	threads.emplace_back([&video, &latest, out, stats = &stages.back(), elapsed_ms]() {
+		for (int64_t idx = 0; video.isOpened(); idx++) {
+			auto t = chrono::steady_clock::now();
+			auto f = make_shared<VideoFrame>();
+			f->idx = idx;
+			if (!video.read(f->frame)) {
+				break;
+			}
+			f->captured = chrono::steady_clock::now();
+			stats->busy_ms += elapsed_ms(t);
+			stats->frames++;
+			// a live source overwrites the frame nobody has taken yet
+			if (!(out ? out->push(f) : latest.put(f))) {
+				break;
+			}
+			stats->queued += out ? out->size() : 0;
+		}
+		if (out) out->close(); else latest.close();
+	});
+
+	// where the next stage added takes its frames from
+	function<bool(FramePtr&)> pop_in;
+	if (out) {
+		pop_in = [out](FramePtr &f) { return out->pop(f); };
+	}
+	else {
+		pop_in = [&latest](FramePtr &f) { return latest.take(f); };
+	}
+
+	// work returning false stops the stage without passing the frame on, which only happens on shutdown
+	auto add_stage = [&](const std::string &name, std::function<bool(VideoFrame&)> work, size_t queue_size) {
+		queues.emplace_back(queue_size);
+		FrameQueue *out = &queues.back();
+		stages.push_back({ name });
+		threads.emplace_back([pop_in, out, stats = &stages.back(), work, elapsed_ms]() {
+			FramePtr f;
+			while (pop_in(f)) {
+				auto t = chrono::steady_clock::now();
+				if (!work(*f)) {
+					break;
+				}
+				stats->busy_ms += elapsed_ms(t);
+				stats->frames++;
+				if (!out->push(f)) {
+					break;
+				}
+				stats->queued += out->size();
+			}
+			out->close();
+		});
+		pop_in = [out](FramePtr &f) { return out->pop(f); };
+	};
+
+	auto preprocess = [&](VideoFrame &f) {
+		f.image = image_to_tensor(f.frame);
+		if (default_predictor) {
+			f.input = default_predictor->preprocess(f.image);
+		}
+	};
+	// in real-time mode the newest frame is only taken once inference can start on it, and propagated frames
+	// don't need preprocessing at all
+	KeyframeScheduler scheduler(keyframes);
+	bool use_keyframes = keyframes.interval > 1;
+	bool inline_preprocess = realtime || use_keyframes;
+	if (!inline_preprocess) {
+		add_stage("preprocess", [&](VideoFrame &f) { preprocess(f); return true; }, queue_size);
+	}
+	BoundedQueue<int> idle_workers(async_predictor ? async_predictor->num_workers() : 1);
+	if (async_predictor && !use_keyframes) {
+		// submitting and collecting on separate threads keeps all of its workers busy
+		size_t in_flight = async_predictor->default_buffer_size();
+		if (realtime) {
+			// one frame per worker, so that workers alternate on the newest frames
+			in_flight = async_predictor->num_workers();
+			for (size_t i = 0; i < in_flight; i++) {
+				idle_workers.push(0);
+			}
+			auto take_newest = pop_in;
+			pop_in = [take_newest, &idle_workers](FramePtr &f) {
+				int worker;
+				return idle_workers.pop(worker) && take_newest(f);
+			};
+		}
+		add_stage("inference_put", [&](VideoFrame &f) {
+			if (realtime) preprocess(f);
+			// only fails on shutdown
+			return async_predictor->put(f.image);
+		}, in_flight);
+		add_stage("inference_get", [&](VideoFrame &f) {
+			f.predictions = async_predictor->get();
+			if (realtime) idle_workers.push(0);
+			return true;
+		}, queue_size);
+	}
+	else {
+		// tracking needs the predictions of the frame before, so keyframes are detected one by one
+		add_stage("inference", [&](VideoFrame &f) {
+			f.propagated = false;
+			if (use_keyframes) {
+				f.predictions = scheduler.propagate(f.frame);
+				if (f.predictions) {
+					f.propagated = true;
+					return true;
+				}
+			}
+			if (inline_preprocess) preprocess(f);
+			f.predictions = default_predictor ?
+				default_predictor->predict_preprocessed(f.input) : m_predictor->predict(f.image);
+			if (!f.predictions) {
+				return false; // AsyncPredictor::predict() after interrupt_put(), on shutdown
+			}
+			if (use_keyframes) {
+				scheduler.keyframe(f.frame, f.predictions);
+			}
+			return true;
+		}, queue_size);
+	}
+	if (visualize) {
+		add_stage("visualize", [visualize](VideoFrame &f) { visualize(f); return true; }, queue_size);
+	}
+
+	// sink stage on the calling thread, e.g. for windows that must be shown from the main thread
+	stages.push_back({ "output" });
+	auto &sink = stages.back();
+	double latency_sum = 0, latency_max = 0;
+	FramePtr f;
+	for (int64_t last_idx = -1; pop_in(f); last_idx = f->idx) {
+		assert(f->idx > last_idx && (realtime || f->idx == last_idx + 1));
+		auto t = chrono::steady_clock::now();
+		bool more = consumer(*f);
+		sink.busy_ms += elapsed_ms(t);
+		sink.frames++;
+
+		// capture-to-result
+		double latency = elapsed_ms(f->captured);
+		latency_sum += latency;
+		latency_max = max(latency_max, latency);
+		if (!more) {
 			break;
 		}
-		process_predictions(frame, m_predictor->predict(image_to_tensor(frame)));
+	}
+
+	// stops all stages, in case the consumer quit early
+	latest.close();
+	idle_workers.close();
+	for (auto &queue : queues) {
+		queue.close();
+	}
+	// inference_put, or inference with keyframes, may be waiting for a free result slot that only get() would
+	// free; the stages stop on a failed put() instead of passing the frame on to a get()
+	if (async_predictor) {
+		async_predictor->interrupt_put();
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+	// results of frames submitted after an early stop
+	if (async_predictor) {
+		while (async_predictor->len() > 0) {
+			async_predictor->get();
+		}
+		async_predictor->interrupt_put(false);
+	}
+
+	double total_ms = elapsed_ms(t0);
+	char buf[256];
+	for (auto &stage : stages) {
+		snprintf(buf, sizeof(buf), ">>>>>>> %s: %d frames, %dms busy (%d%%), %.1f queued on average\n",
+			stage.name.c_str(), (int)stage.frames, (int)stage.busy_ms,
+			(int)(total_ms > 0 ? stage.busy_ms * 100 / total_ms : 0),
+			stage.frames > 0 ? (double)stage.queued / stage.frames : 0.0);
+		cout << buf;
+	}
+	snprintf(buf, sizeof(buf), ">>>>>>> latency: %dms average, %dms max, %d frames dropped\n",
+		(int)(sink.frames > 0 ? latency_sum / sink.frames : 0), (int)latency_max, (int)latest.dropped());
+	cout << buf;
+	if (use_keyframes) {
+		snprintf(buf, sizeof(buf), ">>>>>>> keyframes: %d detected, %d propagated\n",
+			(int)scheduler.keyframes(), (int)scheduler.propagated());
+		cout << buf;
 	}
 }
\ No newline at end of file
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <Detectron2/MetaArch/MetaArch.h>
 #include <Detectron2/Structures/Instances.h>
+#include <Detectron2/Utils/KeyframeScheduler.h>
 #include <Detectron2/Utils/Predictor.h>
 #include <Detectron2/Utils/VideoAnalyzer.h>
 #include <Detectron2/Utils/Visualizer.h>
 
+#include <chrono>
+
 namespace Detectron2
 {
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -24,6 +28,10 @@ namespace Detectron2
 													// If not given, will show output in an OpenCV window.
 			CfgNode::OptionList opts;				// Modify config options using the command-line 'KEY VALUE' pairs
 			float confidence_threshold = 0.5; 		// Minimum score for instance predictions to be shown
+			bool realtime = false;					// Live sources: always process the newest frame, dropping
+													// the ones inference can't keep up with
+			KeyframeScheduler::Options keyframes;	// Videos: run the detector on keyframes only, tracking
+													// instances in between
 		};
 		static void start(const Options &options);
 
@@ -52,6 +60,18 @@ namespace Detectron2
 		/**
 			Visualizes predictions on frames of the input video.
 
+			Decoding, preprocessing, inference and visualization each run on their own thread, connected by
+			bounded queues, while vis_frame_processor (e.g. encoding) runs on the calling thread. Frames come
+			out in input order, and the throughput is that of the slowest stage.
+
+			With realtime, for webcams and streams, capture keeps overwriting a single "latest frame" slot and
+			inference always takes the newest one, so latency stays bounded and late frames are dropped. An
+			AsyncPredictor gets one frame per worker, letting its workers alternate frames.
+
+			With keyframes.interval > 1, the detector only runs on the frames KeyframeScheduler picks, and
+			instances are tracked from one to the next in between. Frames then go through the predictor one
+			at a time, since tracking needs the predictions of the frame before.
+
 			Args:
 				video (cv2.VideoCapture): a :class:`VideoCapture` object, whose source can be
 					either a webcam or a video file.
@@ -59,14 +79,39 @@ namespace Detectron2
 			Yields:
 				ndarray: BGR visualizations of each video frame.
 		*/
-		void run_on_video(cv::VideoCapture &video, std::function<bool(cv::Mat)> vis_frame_processor);
+		void run_on_video(cv::VideoCapture &video, std::function<bool(cv::Mat)> vis_frame_processor,
+			bool realtime = false, const KeyframeScheduler::Options &keyframes = KeyframeScheduler::Options());
 
 		/**
-			Captures predictions from frames of the input video.
+			Captures predictions from frames of the input video. Pipelined like run_on_video(), with the
+			analyzer callbacks running on the calling thread. With keyframes, on_instance_predictions() is told
+			which frames had their predictions propagated instead of detected.
 		 */
-		void analyze_on_video(cv::VideoCapture &video, VideoAnalyzer &analyzer);
+		void analyze_on_video(cv::VideoCapture &video, VideoAnalyzer &analyzer, bool realtime = false,
+			const KeyframeScheduler::Options &keyframes = KeyframeScheduler::Options());
 
 	private:
+		// one frame travelling through the video pipeline
+		struct VideoFrame {
+			int64_t idx = 0;
+			std::chrono::steady_clock::time_point captured;
+			cv::Mat frame;					// decoded BGR frame, also the storage of image
+			torch::Tensor image;
+			DatasetMapperOutput input;		// preprocessed model input, when the predictor is a DefaultPredictor
+			InstancesPtr predictions;
+			bool propagated = false;		// predictions were tracked from the last keyframe
+			cv::Mat vis_frame;
+		};
+
+		/**
+			Runs decode -> preprocess -> inference [-> visualize] threads over the video, then calls consumer
+			on this thread for every frame in order, until the video ends or consumer returns false. Prints
+			how busy each stage was and how full its output queue ran, capture-to-result latency and, with
+			realtime, how many frames were dropped, and with keyframes, how many frames were propagated.
+		*/
+		void run_pipeline(cv::VideoCapture &video, std::function<void(VideoFrame&)> visualize,
+			std::function<bool(VideoFrame&)> consumer, bool realtime, const KeyframeScheduler::Options &keyframes);
+
 		Metadata m_metadata;
 		torch::Device m_cpu_device;
 		ColorMode m_instance_mode;
@@ -65,9 +65,9 @@ public:
 		assert(_mask);
 
 		// Create a 1D array, and reshape it to fortran/Matlab column-major array
-		auto ret = torch::from_blob(_mask, { _h, _w, _n }, Deleter(free), torch::kUInt8);
+		auto ret = torch::from_blob(_mask, { (int64_t)_n, (int64_t)_w, (int64_t)_h }, Deleter(free), torch::kUInt8);
 		_mask = nullptr;
-		return ret;
+		return ret.permute({ 2, 1, 0 });
 	}
 };
 
@@ -106,7 +106,9 @@ MaskObjectVec pycocotools::encode(torch::Tensor mask) {
 	auto w = mask.size(1);
 	auto n = mask.size(2);
 	RLEs Rs(n);
-	rleEncode(Rs._R, mask.cpu().data_ptr<byte>(), h, w, n);
+	// rleEncode() reads each mask in column-major order
+	auto data = mask.permute({ 2, 1, 0 }).contiguous().cpu();
+	rleEncode(Rs._R, data.data_ptr<byte>(), h, w, n);
 	auto objs = _toString(Rs);
 	return objs;
 }
@@ -1,5 +1,7 @@
 // Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved
+#include <ATen/Parallel.h>
 #include <ATen/TensorUtils.h>
+#include <ATen/cpu/vec256/vec256.h>
 #include "ROIAlign.h"
 
 namespace detectron2 {
@@ -129,92 +131,255 @@ void ROIAlignForward(
     bool aligned) {
   int n_rois = nthreads / channels / pooled_width / pooled_height;
   // (n, c, ph, pw) is an element in the pooled output
-  // can be parallelized using omp
-  // #pragma omp parallel for num_threads(32)
-  for (int n = 0; n < n_rois; n++) {
-    int index_n = n * channels * pooled_width * pooled_height;
-
-    const T* offset_rois = rois + n * 5;
-    int roi_batch_ind = offset_rois[0];
+  // ROIs are independent, so each worker takes a contiguous range of them and
+  // reuses one pre_calc buffer for all ROIs in its range
+  at::parallel_for(0, n_rois, 1, [&](int64_t begin, int64_t end) {
+    std::vector<PreCalc<T>> pre_calc;
+    for (int n = begin; n < end; n++) {
+      int index_n = n * channels * pooled_width * pooled_height;
+
+      const T* offset_rois = rois + n * 5;
+      int roi_batch_ind = offset_rois[0];
+
+      // Do not use rounding; this implementation detail is critical
+      T offset = aligned ? (T)0.5 : (T)0.0;
+      T roi_start_w = offset_rois[1] * spatial_scale - offset;
+      T roi_start_h = offset_rois[2] * spatial_scale - offset;
+      T roi_end_w = offset_rois[3] * spatial_scale - offset;
+      T roi_end_h = offset_rois[4] * spatial_scale - offset;
+
+      T roi_width = roi_end_w - roi_start_w;
+      T roi_height = roi_end_h - roi_start_h;
+      if (aligned) {
+        AT_ASSERTM(
+            roi_width >= 0 && roi_height >= 0,
+            "ROIs in ROIAlign cannot have non-negative size!");
+      } else { // for backward-compatibility only
+        roi_width = std::max(roi_width, (T)1.);
+        roi_height = std::max(roi_height, (T)1.);
+      }
+      T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
+      T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
+
+      // We use roi_bin_grid to sample the grid and mimic integral
+      int roi_bin_grid_h = (sampling_ratio > 0)
+          ? sampling_ratio
+          : ceil(roi_height / pooled_height); // e.g., = 2
+      int roi_bin_grid_w = (sampling_ratio > 0)
+          ? sampling_ratio
+          : ceil(roi_width / pooled_width);
+
+      // We do average (integral) pooling inside a bin
+      // When the grid is empty, output zeros == 0/1, instead of NaN.
+      const T count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1); // e.g. = 4
+
+      // we want to precalculate indices and weights shared by all channels,
+      // this is the key point of optimization
+      size_t pre_calc_size =
+          roi_bin_grid_h * roi_bin_grid_w * pooled_width * pooled_height;
+      if (pre_calc.size() < pre_calc_size) {
+        pre_calc.resize(pre_calc_size);
+      }
+      pre_calc_for_bilinear_interpolate(
+          height,
+          width,
+          pooled_height,
+          pooled_width,
+          roi_bin_grid_h,
+          roi_bin_grid_w,
+          roi_start_h,
+          roi_start_w,
+          bin_size_h,
+          bin_size_w,
+          roi_bin_grid_h,
+          roi_bin_grid_w,
+          pre_calc);
+
+      for (int c = 0; c < channels; c++) {
+        int index_n_c = index_n + c * pooled_width * pooled_height;
+        const T* offset_input =
+            input + (roi_batch_ind * channels + c) * height * width;
+        int pre_calc_index = 0;
+
+        for (int ph = 0; ph < pooled_height; ph++) {
+          for (int pw = 0; pw < pooled_width; pw++) {
+            int index = index_n_c + ph * pooled_width + pw;
+
+            T output_val = 0.;
+            for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+              for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+                PreCalc<T> pc = pre_calc[pre_calc_index];
+                output_val += pc.w1 * offset_input[pc.pos1] +
+                    pc.w2 * offset_input[pc.pos2] +
+                    pc.w3 * offset_input[pc.pos3] +
+                    pc.w4 * offset_input[pc.pos4];
+
+                pre_calc_index += 1;
+              }
+            }
+            output_val /= count;
+
+            output[index] = output_val;
+          } // for pw
+        } // for ph
+      } // for c
+    } // for n
+  });
+}
 
-    // Do not use rounding; this implementation detail is critical
-    T offset = aligned ? (T)0.5 : (T)0.0;
-    T roi_start_w = offset_rois[1] * spatial_scale - offset;
-    T roi_start_h = offset_rois[2] * spatial_scale - offset;
-    T roi_end_w = offset_rois[3] * spatial_scale - offset;
-    T roi_end_h = offset_rois[4] * spatial_scale - offset;
+// acc[c] += w1 * p1[c] + w2 * p2[c] + w3 * p3[c] + w4 * p4[c] over contiguous
+// channels, using SIMD FMA where Vec256 supports the type
+template <typename T>
+inline void bilinear_accumulate_channels(
+    T* acc,
+    const T* p1,
+    const T* p2,
+    const T* p3,
+    const T* p4,
+    const T w1,
+    const T w2,
+    const T w3,
+    const T w4,
+    const int channels) {
+  using Vec = at::vec256::Vec256<T>;
+  const Vec vw1(w1), vw2(w2), vw3(w3), vw4(w4);
+  int c = 0;
+  for (; c + Vec::size() <= channels; c += Vec::size()) {
+    Vec v = Vec::loadu(acc + c);
+    v = at::vec256::fmadd(vw1, Vec::loadu(p1 + c), v);
+    v = at::vec256::fmadd(vw2, Vec::loadu(p2 + c), v);
+    v = at::vec256::fmadd(vw3, Vec::loadu(p3 + c), v);
+    v = at::vec256::fmadd(vw4, Vec::loadu(p4 + c), v);
+    v.store(acc + c);
+  }
+  for (; c < channels; c++) {
+    acc[c] += w1 * p1[c] + w2 * p2[c] + w3 * p3[c] + w4 * p4[c];
+  }
+}
 
-    T roi_width = roi_end_w - roi_start_w;
-    T roi_height = roi_end_h - roi_start_h;
-    if (aligned) {
-      AT_ASSERTM(
-          roi_width >= 0 && roi_height >= 0,
-          "ROIs in ROIAlign cannot have non-negative size!");
-    } else { // for backward-compatibility only
-      roi_width = std::max(roi_width, (T)1.);
-      roi_height = std::max(roi_height, (T)1.);
-    }
-    T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
-    T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
+template <>
+inline void bilinear_accumulate_channels<at::Half>(
+    at::Half* acc,
+    const at::Half* p1,
+    const at::Half* p2,
+    const at::Half* p3,
+    const at::Half* p4,
+    const at::Half w1,
+    const at::Half w2,
+    const at::Half w3,
+    const at::Half w4,
+    const int channels) {
+  for (int c = 0; c < channels; c++) {
+    acc[c] += w1 * p1[c] + w2 * p2[c] + w3 * p3[c] + w4 * p4[c];
+  }
+}
 
-    // We use roi_bin_grid to sample the grid and mimic integral
-    int roi_bin_grid_h = (sampling_ratio > 0)
-        ? sampling_ratio
-        : ceil(roi_height / pooled_height); // e.g., = 2
-    int roi_bin_grid_w =
-        (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / pooled_width);
+// Same as ROIAlignForward, but input is (N, H, W, C) and output is written as
+// (n_rois, pooled_height, pooled_width, C), i.e. both are channels-last. The
+// innermost loop runs over contiguous channels instead of gathering scattered
+// pixels of one channel plane at a time.
+template <typename T>
+void ROIAlignForwardChannelsLast(
+    const int nthreads,
+    const T* input,
+    const T& spatial_scale,
+    const int channels,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    const T* rois,
+    T* output,
+    bool aligned) {
+  int n_rois = nthreads / channels / pooled_width / pooled_height;
+  at::parallel_for(0, n_rois, 1, [&](int64_t begin, int64_t end) {
+    std::vector<PreCalc<T>> pre_calc;
+    for (int n = begin; n < end; n++) {
+      const T* offset_rois = rois + n * 5;
+      int roi_batch_ind = offset_rois[0];
+
+      // Do not use rounding; this implementation detail is critical
+      T offset = aligned ? (T)0.5 : (T)0.0;
+      T roi_start_w = offset_rois[1] * spatial_scale - offset;
+      T roi_start_h = offset_rois[2] * spatial_scale - offset;
+      T roi_end_w = offset_rois[3] * spatial_scale - offset;
+      T roi_end_h = offset_rois[4] * spatial_scale - offset;
+
+      T roi_width = roi_end_w - roi_start_w;
+      T roi_height = roi_end_h - roi_start_h;
+      if (aligned) {
+        AT_ASSERTM(
+            roi_width >= 0 && roi_height >= 0,
+            "ROIs in ROIAlign cannot have non-negative size!");
+      } else { // for backward-compatibility only
+        roi_width = std::max(roi_width, (T)1.);
+        roi_height = std::max(roi_height, (T)1.);
+      }
+      T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
+      T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
+
+      int roi_bin_grid_h = (sampling_ratio > 0)
+          ? sampling_ratio
+          : ceil(roi_height / pooled_height);
+      int roi_bin_grid_w = (sampling_ratio > 0)
+          ? sampling_ratio
+          : ceil(roi_width / pooled_width);
+      const T count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1);
+
+      size_t pre_calc_size =
+          roi_bin_grid_h * roi_bin_grid_w * pooled_width * pooled_height;
+      if (pre_calc.size() < pre_calc_size) {
+        pre_calc.resize(pre_calc_size);
+      }
+      pre_calc_for_bilinear_interpolate(
+          height,
+          width,
+          pooled_height,
+          pooled_width,
+          roi_bin_grid_h,
+          roi_bin_grid_w,
+          roi_start_h,
+          roi_start_w,
+          bin_size_h,
+          bin_size_w,
+          roi_bin_grid_h,
+          roi_bin_grid_w,
+          pre_calc);
 
-    // We do average (integral) pooling inside a bin
-    // When the grid is empty, output zeros == 0/1, instead of NaN.
-    const T count = std::max(roi_bin_grid_h * roi_bin_grid_w, 1); // e.g. = 4
-
-    // we want to precalculate indices and weights shared by all channels,
-    // this is the key point of optimization
-    std::vector<PreCalc<T>> pre_calc(
-        roi_bin_grid_h * roi_bin_grid_w * pooled_width * pooled_height);
-    pre_calc_for_bilinear_interpolate(
-        height,
-        width,
-        pooled_height,
-        pooled_width,
-        roi_bin_grid_h,
-        roi_bin_grid_w,
-        roi_start_h,
-        roi_start_w,
-        bin_size_h,
-        bin_size_w,
-        roi_bin_grid_h,
-        roi_bin_grid_w,
-        pre_calc);
-
-    for (int c = 0; c < channels; c++) {
-      int index_n_c = index_n + c * pooled_width * pooled_height;
       const T* offset_input =
-          input + (roi_batch_ind * channels + c) * height * width;
+          input + (int64_t)roi_batch_ind * height * width * channels;
       int pre_calc_index = 0;
-
       for (int ph = 0; ph < pooled_height; ph++) {
         for (int pw = 0; pw < pooled_width; pw++) {
-          int index = index_n_c + ph * pooled_width + pw;
-
-          T output_val = 0.;
+          // output is zero-initialized by the caller
+          T* acc = output +
+              (((int64_t)n * pooled_height + ph) * pooled_width + pw) *
+                  channels;
           for (int iy = 0; iy < roi_bin_grid_h; iy++) {
             for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-              PreCalc<T> pc = pre_calc[pre_calc_index];
-              output_val += pc.w1 * offset_input[pc.pos1] +
-                  pc.w2 * offset_input[pc.pos2] +
-                  pc.w3 * offset_input[pc.pos3] + pc.w4 * offset_input[pc.pos4];
-
+              const PreCalc<T>& pc = pre_calc[pre_calc_index];
+              bilinear_accumulate_channels(
+                  acc,
+                  offset_input + (int64_t)pc.pos1 * channels,
+                  offset_input + (int64_t)pc.pos2 * channels,
+                  offset_input + (int64_t)pc.pos3 * channels,
+                  offset_input + (int64_t)pc.pos4 * channels,
+                  pc.w1,
+                  pc.w2,
+                  pc.w3,
+                  pc.w4,
+                  channels);
               pre_calc_index += 1;
             }
           }
-          output_val /= count;
-
-          output[index] = output_val;
+          for (int c = 0; c < channels; c++) {
+            acc[c] /= count;
+          }
         } // for pw
       } // for ph
-    } // for c
-  } // for n
+    } // for n
+  });
 }
 
 template <typename T>
@@ -419,15 +584,42 @@ at::Tensor ROIAlign_forward_cpu(
   auto height = input.size(2);
   auto width = input.size(3);
 
+  // channels-last features are pooled by the channel-inner kernel, and the
+  // pooled output keeps their memory format
+  bool channels_last = input.dim() == 4 &&
+      input.suggest_memory_format() == at::MemoryFormat::ChannelsLast;
+  auto memory_format = channels_last ? at::MemoryFormat::ChannelsLast
+                                     : at::MemoryFormat::Contiguous;
+
   at::Tensor output = at::zeros(
-      {num_rois, channels, pooled_height, pooled_width}, input.options());
+      {num_rois, channels, pooled_height, pooled_width},
+      input.options().memory_format(memory_format));
 
   auto output_size = num_rois * pooled_height * pooled_width * channels;
 
   if (output.numel() == 0)
     return output;
 
-  auto input_ = input.contiguous(), rois_ = rois.contiguous();
+  auto input_ = input.contiguous(memory_format), rois_ = rois.contiguous();
+  if (channels_last) {
+    AT_DISPATCH_FLOATING_TYPES_AND_HALF(
+        input.scalar_type(), "ROIAlign_forward", [&] {
+          ROIAlignForwardChannelsLast<scalar_t>(
+              output_size,
+              input_.data_ptr<scalar_t>(),
+              spatial_scale,
+              channels,
+              height,
+              width,
+              pooled_height,
+              pooled_width,
+              sampling_ratio,
+              rois_.data_ptr<scalar_t>(),
+              output.data_ptr<scalar_t>(),
+              aligned);
+        });
+    return output;
+  }
   AT_DISPATCH_FLOATING_TYPES_AND_HALF(
       input.scalar_type(), "ROIAlign_forward", [&] {
         ROIAlignForward<scalar_t>(
@@ -1,4 +1,5 @@
 // Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved
+#include <ATen/Parallel.h>
 #include "box_iou_rotated.h"
 #include "box_iou_rotated_utils.h"
 
@@ -11,13 +12,28 @@ void box_iou_rotated_cpu_kernel(
     at::Tensor& ious) {
   auto num_boxes1 = boxes1.size(0);
   auto num_boxes2 = boxes2.size(0);
+  auto b1 = boxes1.data_ptr<T>();
+  auto b2 = boxes2.data_ptr<T>();
+  auto out = ious.data_ptr<float>();
 
-  for (int i = 0; i < num_boxes1; i++) {
-    for (int j = 0; j < num_boxes2; j++) {
-      ious[i * num_boxes2 + j] = single_box_iou_rotated<T>(
-          boxes1[i].data_ptr<T>(), boxes2[j].data_ptr<T>());
-    }
+  std::vector<T> radius2(num_boxes2);
+  for (int64_t j = 0; j < num_boxes2; j++) {
+    radius2[j] = rotated_box_radius<T>(b2 + j * 5);
   }
+
+  at::parallel_for(0, num_boxes1, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      auto box1 = b1 + i * 5;
+      auto radius1 = rotated_box_radius<T>(box1);
+      auto out_i = out + i * num_boxes2;
+      for (int64_t j = 0; j < num_boxes2; j++) {
+        auto box2 = b2 + j * 5;
+        out_i[j] = rotated_boxes_may_overlap<T>(box1, radius1, box2, radius2[j])
+            ? single_box_iou_rotated<T>(box1, box2)
+            : 0.f;
+      }
+    }
+  });
 }
 
 at::Tensor box_iou_rotated_cpu(
@@ -360,4 +360,25 @@ single_box_iou_rotated(T const* const box1_raw, T const* const box2_raw) {
   return iou;
 }
 
+// Radius of the circle around a (x_ctr, y_ctr, w, h, a) box; it does not
+// depend on the angle.
+template <typename T>
+HOST_DEVICE_INLINE T rotated_box_radius(T const* const box) {
+  return T(0.5) * sqrt(box[2] * box[2] + box[3] * box[3]);
+}
+
+// Cheap prefilter for single_box_iou_rotated: boxes whose bounding circles
+// are apart cannot intersect, so their IoU is 0.
+template <typename T>
+HOST_DEVICE_INLINE bool rotated_boxes_may_overlap(
+    T const* const box1,
+    const T radius1,
+    T const* const box2,
+    const T radius2) {
+  T dx = box1[0] - box2[0];
+  T dy = box1[1] - box2[1];
+  T r = radius1 + radius2;
+  return dx * dx + dy * dy < r * r;
+}
+
 } // namespace detectron2
@@ -4,6 +4,46 @@
 
 namespace detectron2 {
 
+int deform_conv_forward_cpu(
+    at::Tensor input,
+    at::Tensor weight,
+    at::Tensor offset,
+    at::Tensor output,
+    at::Tensor columns,
+    at::Tensor ones,
+    int kW,
+    int kH,
+    int dW,
+    int dH,
+    int padW,
+    int padH,
+    int dilationW,
+    int dilationH,
+    int group,
+    int deformable_group,
+    int im2col_step);
+
+void modulated_deform_conv_cpu_forward(
+    at::Tensor input,
+    at::Tensor weight,
+    at::Tensor bias,
+    at::Tensor ones,
+    at::Tensor offset,
+    at::Tensor mask,
+    at::Tensor output,
+    at::Tensor columns,
+    int kernel_h,
+    int kernel_w,
+    const int stride_h,
+    const int stride_w,
+    const int pad_h,
+    const int pad_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int group,
+    const int deformable_group,
+    const bool with_bias);
+
 #ifdef WITH_CUDA
 int deform_conv_forward_cuda(
     at::Tensor input,
@@ -157,7 +197,24 @@ inline int deform_conv_forward(
     AT_ERROR("Not compiled with GPU support");
 #endif
   }
-  AT_ERROR("Not implemented on the CPU");
+  return deform_conv_forward_cpu(
+      input,
+      weight,
+      offset,
+      output,
+      columns,
+      ones,
+      kW,
+      kH,
+      dW,
+      dH,
+      padW,
+      padH,
+      dilationW,
+      dilationH,
+      group,
+      deformable_group,
+      im2col_step);
 }
 
 inline int deform_conv_backward_input(
@@ -308,7 +365,26 @@ inline void modulated_deform_conv_forward(
     AT_ERROR("Not compiled with GPU support");
 #endif
   }
-  AT_ERROR("Not implemented on the CPU");
+  return modulated_deform_conv_cpu_forward(
+      input,
+      weight,
+      bias,
+      ones,
+      offset,
+      mask,
+      output,
+      columns,
+      kernel_h,
+      kernel_w,
+      stride_h,
+      stride_w,
+      pad_h,
+      pad_w,
+      dilation_h,
+      dilation_w,
+      group,
+      deformable_group,
+      with_bias);
 }
 
 inline void modulated_deform_conv_backward(
@@ -0,0 +1,461 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved
+
+// CPU port of the forward paths in deform_conv_cuda.cu and
+// deform_conv_cuda_kernel.cu. Columns are built by a multithreaded deformable
+// im2col and multiplied with the weights by one GEMM per group, processing
+// im2col_step images at a time exactly like the CUDA version.
+
+#include <ATen/Parallel.h>
+#include <torch/types.h>
+
+#include "deform_conv.h"
+
+#include <cmath>
+
+namespace {
+
+template <typename scalar_t>
+scalar_t deformable_im2col_bilinear_cpu(
+    const scalar_t* bottom_data,
+    const int data_width,
+    const int height,
+    const int width,
+    scalar_t h,
+    scalar_t w) {
+  int h_low = floor(h);
+  int w_low = floor(w);
+  int h_high = h_low + 1;
+  int w_high = w_low + 1;
+
+  scalar_t lh = h - h_low;
+  scalar_t lw = w - w_low;
+  scalar_t hh = 1 - lh, hw = 1 - lw;
+
+  scalar_t v1 = 0;
+  if (h_low >= 0 && w_low >= 0)
+    v1 = bottom_data[h_low * data_width + w_low];
+  scalar_t v2 = 0;
+  if (h_low >= 0 && w_high <= width - 1)
+    v2 = bottom_data[h_low * data_width + w_high];
+  scalar_t v3 = 0;
+  if (h_high <= height - 1 && w_low >= 0)
+    v3 = bottom_data[h_high * data_width + w_low];
+  scalar_t v4 = 0;
+  if (h_high <= height - 1 && w_high <= width - 1)
+    v4 = bottom_data[h_high * data_width + w_high];
+
+  scalar_t w1 = hh * hw, w2 = hh * lw, w3 = lh * hw, w4 = lh * lw;
+
+  scalar_t val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
+  return val;
+}
+
+// Fills data_col of shape
+// (num_channels * kernel_h * kernel_w, batch_size * height_col * width_col).
+// data_mask is nullptr for the non-modulated version.
+template <typename scalar_t>
+void deformable_im2col_cpu_kernel(
+    const scalar_t* data_im,
+    const scalar_t* data_offset,
+    const scalar_t* data_mask,
+    const int height,
+    const int width,
+    const int kernel_h,
+    const int kernel_w,
+    const int pad_h,
+    const int pad_w,
+    const int stride_h,
+    const int stride_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int channel_per_deformable_group,
+    const int batch_size,
+    const int num_channels,
+    const int deformable_group,
+    const int height_col,
+    const int width_col,
+    scalar_t* data_col) {
+  // one task per (channel, image) plane; each one owns kernel_h * kernel_w
+  // disjoint row segments of data_col
+  at::parallel_for(
+      0, num_channels * batch_size, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t index = begin; index < end; index++) {
+          const int b_col = index % batch_size;
+          const int c_im = index / batch_size;
+          const int c_col = c_im * kernel_h * kernel_w;
+
+          // compute deformable group index
+          const int deformable_group_index =
+              c_im / channel_per_deformable_group;
+
+          const scalar_t* data_im_ptr = data_im +
+              ((int64_t)b_col * num_channels + c_im) * height * width;
+          const scalar_t* data_offset_ptr = data_offset +
+              ((int64_t)b_col * deformable_group + deformable_group_index) *
+                  2 * kernel_h * kernel_w * height_col * width_col;
+          const scalar_t* data_mask_ptr = data_mask
+              ? data_mask +
+                  ((int64_t)b_col * deformable_group + deformable_group_index) *
+                      kernel_h * kernel_w * height_col * width_col
+              : nullptr;
+
+          for (int i = 0; i < kernel_h; ++i) {
+            for (int j = 0; j < kernel_w; ++j) {
+              const int k = i * kernel_w + j;
+              const scalar_t* offset_h_ptr =
+                  data_offset_ptr + (2 * k) * height_col * width_col;
+              const scalar_t* offset_w_ptr =
+                  data_offset_ptr + (2 * k + 1) * height_col * width_col;
+              const scalar_t* mask_ptr = data_mask_ptr
+                  ? data_mask_ptr + k * height_col * width_col
+                  : nullptr;
+              scalar_t* data_col_ptr = data_col +
+                  (((int64_t)c_col + k) * batch_size + b_col) * height_col *
+                      width_col;
+
+              for (int h_col = 0; h_col < height_col; ++h_col) {
+                const int h_in = h_col * stride_h - pad_h;
+                for (int w_col = 0; w_col < width_col; ++w_col) {
+                  const int w_in = w_col * stride_w - pad_w;
+                  const int pos = h_col * width_col + w_col;
+                  scalar_t val = static_cast<scalar_t>(0);
+                  const scalar_t h_im =
+                      h_in + i * dilation_h + offset_h_ptr[pos];
+                  const scalar_t w_im =
+                      w_in + j * dilation_w + offset_w_ptr[pos];
+                  if (h_im > -1 && w_im > -1 && h_im < height &&
+                      w_im < width) {
+                    val = deformable_im2col_bilinear_cpu(
+                        data_im_ptr, width, height, width, h_im, w_im);
+                  }
+                  data_col_ptr[pos] = mask_ptr ? val * mask_ptr[pos] : val;
+                }
+              }
+            }
+          }
+        }
+      });
+}
+
+void deformable_im2col_cpu(
+    const at::Tensor data_im,
+    const at::Tensor data_offset,
+    const at::Tensor data_mask,
+    const int channels,
+    const int height,
+    const int width,
+    const int ksize_h,
+    const int ksize_w,
+    const int pad_h,
+    const int pad_w,
+    const int stride_h,
+    const int stride_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int parallel_imgs,
+    const int deformable_group,
+    at::Tensor data_col) {
+  int height_col =
+      (height + 2 * pad_h - (dilation_h * (ksize_h - 1) + 1)) / stride_h + 1;
+  int width_col =
+      (width + 2 * pad_w - (dilation_w * (ksize_w - 1) + 1)) / stride_w + 1;
+  int channel_per_deformable_group = channels / deformable_group;
+
+  AT_DISPATCH_FLOATING_TYPES(
+      data_im.scalar_type(), "deformable_im2col_cpu", ([&] {
+        deformable_im2col_cpu_kernel<scalar_t>(
+            data_im.data_ptr<scalar_t>(),
+            data_offset.data_ptr<scalar_t>(),
+            data_mask.defined() ? data_mask.data_ptr<scalar_t>() : nullptr,
+            height,
+            width,
+            ksize_h,
+            ksize_w,
+            pad_h,
+            pad_w,
+            stride_h,
+            stride_w,
+            dilation_h,
+            dilation_w,
+            channel_per_deformable_group,
+            parallel_imgs,
+            channels,
+            deformable_group,
+            height_col,
+            width_col,
+            data_col.data_ptr<scalar_t>());
+      }));
+}
+
+} // namespace
+
+namespace detectron2 {
+
+int deform_conv_forward_cpu(
+    at::Tensor input,
+    at::Tensor weight,
+    at::Tensor offset,
+    at::Tensor output,
+    at::Tensor columns,
+    at::Tensor ones,
+    int kW,
+    int kH,
+    int dW,
+    int dH,
+    int padW,
+    int padH,
+    int dilationW,
+    int dilationH,
+    int group,
+    int deformable_group,
+    int im2col_step) {
+  TORCH_CHECK(
+      weight.ndimension() == 4,
+      "4D weight tensor (nOutputPlane,nInputPlane,kH,kW) expected");
+  TORCH_CHECK(
+      (weight.size(2) == kH && weight.size(3) == kW),
+      "kernel size should be consistent with weight");
+  TORCH_CHECK(
+      input.ndimension() == 3 || input.ndimension() == 4,
+      "3D or 4D input tensor expected");
+
+  input = input.contiguous();
+  offset = offset.contiguous();
+  weight = weight.contiguous();
+
+  int batch = 1;
+  if (input.ndimension() == 3) {
+    // Force batch
+    batch = 0;
+    input = input.unsqueeze(0);
+    offset = offset.unsqueeze(0);
+  }
+
+  long batchSize = input.size(0);
+  long nInputPlane = input.size(1);
+  long inputHeight = input.size(2);
+  long inputWidth = input.size(3);
+
+  long nOutputPlane = weight.size(0);
+
+  long outputWidth =
+      (inputWidth + 2 * padW - (dilationW * (kW - 1) + 1)) / dW + 1;
+  long outputHeight =
+      (inputHeight + 2 * padH - (dilationH * (kH - 1) + 1)) / dH + 1;
+
+  TORCH_CHECK(
+      nInputPlane == weight.size(1) * group,
+      "invalid number of input planes");
+  TORCH_CHECK(
+      nInputPlane % deformable_group == 0,
+      "input channels must divide deformable group size");
+  TORCH_CHECK((offset.size(0) == batchSize), "invalid batch size of offset");
+  TORCH_CHECK(
+      (offset.size(1) == deformable_group * 2 * kH * kW),
+      "invalid number of channels of offset");
+  TORCH_CHECK(
+      (offset.size(2) == outputHeight && offset.size(3) == outputWidth),
+      "invalid spatial size of offset");
+  TORCH_CHECK(
+      batchSize % im2col_step == 0, "im2col step must divide batchsize");
+
+  output = output.view({batchSize / im2col_step,
+                        im2col_step,
+                        nOutputPlane,
+                        outputHeight,
+                        outputWidth});
+  columns = at::zeros(
+      {nInputPlane * kW * kH, im2col_step * outputHeight * outputWidth},
+      input.options());
+
+  input = input.view({batchSize / im2col_step,
+                      im2col_step,
+                      nInputPlane,
+                      inputHeight,
+                      inputWidth});
+  offset = offset.view({batchSize / im2col_step,
+                        im2col_step,
+                        deformable_group * 2 * kH * kW,
+                        outputHeight,
+                        outputWidth});
+
+  at::Tensor output_buffer = at::zeros(
+      {batchSize / im2col_step,
+       nOutputPlane,
+       im2col_step * outputHeight,
+       outputWidth},
+      output.options());
+
+  output_buffer = output_buffer.view({output_buffer.size(0),
+                                      group,
+                                      output_buffer.size(1) / group,
+                                      output_buffer.size(2),
+                                      output_buffer.size(3)});
+
+  weight = weight.view({group,
+                        weight.size(0) / group,
+                        weight.size(1),
+                        weight.size(2),
+                        weight.size(3)});
+
+  for (int elt = 0; elt < batchSize / im2col_step; elt++) {
+    deformable_im2col_cpu(
+        input[elt],
+        offset[elt],
+        at::Tensor(),
+        nInputPlane,
+        inputHeight,
+        inputWidth,
+        kH,
+        kW,
+        padH,
+        padW,
+        dH,
+        dW,
+        dilationH,
+        dilationW,
+        im2col_step,
+        deformable_group,
+        columns);
+
+    auto columns_g =
+        columns.view({group, columns.size(0) / group, columns.size(1)});
+    for (int g = 0; g < group; g++) {
+      output_buffer[elt][g].flatten(1).addmm_(
+          weight[g].flatten(1), columns_g[g]);
+    }
+  }
+
+  output_buffer =
+      output_buffer.view({output_buffer.size(0),
+                          output_buffer.size(1) * output_buffer.size(2),
+                          output_buffer.size(3),
+                          output_buffer.size(4)});
+
+  output_buffer = output_buffer.view({batchSize / im2col_step,
+                                      nOutputPlane,
+                                      im2col_step,
+                                      outputHeight,
+                                      outputWidth});
+  output_buffer.transpose_(1, 2);
+  output.copy_(output_buffer);
+  output = output.view({batchSize, nOutputPlane, outputHeight, outputWidth});
+
+  if (batch == 0) {
+    output = output.view({nOutputPlane, outputHeight, outputWidth});
+  }
+
+  return 1;
+}
+
+void modulated_deform_conv_cpu_forward(
+    at::Tensor input,
+    at::Tensor weight,
+    at::Tensor bias,
+    at::Tensor ones,
+    at::Tensor offset,
+    at::Tensor mask,
+    at::Tensor output,
+    at::Tensor columns,
+    int kernel_h,
+    int kernel_w,
+    const int stride_h,
+    const int stride_w,
+    const int pad_h,
+    const int pad_w,
+    const int dilation_h,
+    const int dilation_w,
+    const int group,
+    const int deformable_group,
+    const bool with_bias) {
+  input = input.contiguous();
+  offset = offset.contiguous();
+  mask = mask.contiguous();
+  TORCH_CHECK(weight.is_contiguous(), "weight tensor has to be contiguous");
+
+  const int batch = input.size(0);
+  const int channels = input.size(1);
+  const int height = input.size(2);
+  const int width = input.size(3);
+
+  const int channels_out = weight.size(0);
+  const int channels_kernel = weight.size(1);
+  const int kernel_h_ = weight.size(2);
+  const int kernel_w_ = weight.size(3);
+
+  if (kernel_h_ != kernel_h || kernel_w_ != kernel_w)
+    AT_ERROR(
+        "Input shape and kernel shape wont match: (%d x %d vs %d x %d).",
+        kernel_h,
+        kernel_w,
+        kernel_h_,
+        kernel_w_);
+  if (channels != channels_kernel * group)
+    AT_ERROR(
+        "Input shape and kernel channels wont match: (%d vs %d).",
+        channels,
+        channels_kernel * group);
+
+  const int height_out =
+      (height + 2 * pad_h - (dilation_h * (kernel_h - 1) + 1)) / stride_h + 1;
+  const int width_out =
+      (width + 2 * pad_w - (dilation_w * (kernel_w - 1) + 1)) / stride_w + 1;
+
+  // resize output
+  output = output.view({batch, channels_out, height_out, width_out}).zero_();
+  // resize temporary columns
+  columns = at::zeros(
+      {channels * kernel_h * kernel_w, 1 * height_out * width_out},
+      input.options());
+
+  output = output.view({output.size(0),
+                        group,
+                        output.size(1) / group,
+                        output.size(2),
+                        output.size(3)});
+
+  // divide into group
+  auto weight_g = weight.view({group,
+                               weight.size(0) / group,
+                               weight.size(1),
+                               weight.size(2),
+                               weight.size(3)});
+  auto columns_g =
+      columns.view({group, columns.size(0) / group, columns.size(1)});
+
+  for (int b = 0; b < batch; b++) {
+    deformable_im2col_cpu(
+        input[b],
+        offset[b],
+        mask[b],
+        channels,
+        height,
+        width,
+        kernel_h,
+        kernel_w,
+        pad_h,
+        pad_w,
+        stride_h,
+        stride_w,
+        dilation_h,
+        dilation_w,
+        1,
+        deformable_group,
+        columns);
+
+    for (int g = 0; g < group; g++) {
+      output[b][g].flatten(1).addmm_(weight_g[g].flatten(1), columns_g[g]);
+    }
+  }
+
+  output = output.view({output.size(0),
+                        output.size(1) * output.size(2),
+                        output.size(3),
+                        output.size(4)});
+
+  if (with_bias) {
+    output += bias.view({1, bias.size(0), 1, 1});
+  }
+}
+
+} // namespace detectron2
@@ -8,6 +8,13 @@ at::Tensor nms_cpu(
 	const at::Tensor& scores,
 	const double iou_threshold);
 
+// per-class NMS; boxes with different idxs never suppress each other
+at::Tensor batched_nms_cpu(
+	const at::Tensor& dets,
+	const at::Tensor& scores,
+	const at::Tensor& idxs,
+	const double iou_threshold);
+
 #ifdef WITH_CUDA
 at::Tensor nms_cuda(
 	const at::Tensor& dets,
@@ -1,7 +1,94 @@
+#include <ATen/Parallel.h>
+#include <ATen/cpu/vec256/vec256.h>
+#include <algorithm>
 #include "nms.h"
 
 namespace detectron2 {
 
+// Greedy NMS over n boxes already sorted by descending score, given as
+// structure-of-arrays rows. IoU of the kept box against the remaining boxes is
+// computed Vec256::size() lanes at a time and OR'ed into a suppression bitmask
+// of one bit per box; the outer loop simply walks that bitmask for survivors.
+// Rows must be readable for Vec256::size() entries past n; whatever lies there
+// only sets bits that are never read. Writes kept positions (0..n-1) to keep
+// and returns how many there are.
+template <typename scalar_t>
+int64_t nms_sorted_soa(
+    const scalar_t* x1,
+    const scalar_t* y1,
+    const scalar_t* x2,
+    const scalar_t* y2,
+    const scalar_t* areas,
+    const int64_t n,
+    const double iou_threshold,
+    int64_t* keep) {
+  using Vec = at::vec256::Vec256<scalar_t>;
+  constexpr int64_t kLanes = Vec::size();
+  constexpr int64_t kBits = 64;
+  static_assert(kBits % kLanes == 0, "lane blocks must not straddle words");
+
+  std::vector<uint64_t> removed((n + kBits - 1) / kBits, 0);
+  int64_t num_to_keep = 0;
+
+  const Vec zero(0);
+  const Vec threshold(static_cast<scalar_t>(iou_threshold));
+  const uint64_t lanes_mask = (kLanes == kBits) ? ~0ULL : (1ULL << kLanes) - 1;
+  scalar_t lanes[kLanes];
+
+  for (int64_t i = 0; i < n; i++) {
+    if (removed[i / kBits] & (1ULL << (i % kBits)))
+      continue;
+    keep[num_to_keep++] = i;
+
+    const Vec ix1(x1[i]), iy1(y1[i]), ix2(x2[i]), iy2(y2[i]), iarea(areas[i]);
+    // start at the block holding i + 1; bits at or below i are already final
+    for (int64_t j = (i + 1) / kLanes * kLanes; j < n; j += kLanes) {
+      auto& word = removed[j / kBits];
+      auto shift = j % kBits;
+      if (((word >> shift) & lanes_mask) == lanes_mask)
+        continue;
+
+      auto w = at::vec256::maximum(
+          zero,
+          at::vec256::minimum(ix2, Vec::loadu(x2 + j)) -
+              at::vec256::maximum(ix1, Vec::loadu(x1 + j)));
+      auto h = at::vec256::maximum(
+          zero,
+          at::vec256::minimum(iy2, Vec::loadu(y2 + j)) -
+              at::vec256::maximum(iy1, Vec::loadu(y1 + j)));
+      auto inter = w * h;
+      // inter / union > t, without the division; an empty union compares
+      // false, as 0 / 0 did
+      auto over = inter > threshold * (iarea + Vec::loadu(areas + j) - inter);
+      over.store(lanes);
+
+      uint64_t bits = 0;
+      for (int64_t k = 0; k < kLanes; k++) {
+        // true lanes are all-ones, i.e. NaN, which still compares != 0
+        if (lanes[k] != 0)
+          bits |= 1ULL << k;
+      }
+      word |= bits << shift;
+    }
+  }
+  return num_to_keep;
+}
+
+// Returns (5, n + padding) rows x1, y1, x2, y2, area of dets[order].
+// Padding boxes are empty and never overlap anything.
+template <typename scalar_t>
+at::Tensor gather_soa(const at::Tensor& dets, const at::Tensor& order) {
+  constexpr int64_t kLanes = at::vec256::Vec256<scalar_t>::size();
+  auto n = order.size(0);
+  at::Tensor soa = at::zeros({5, n + kLanes}, dets.options());
+  auto sorted = dets.index_select(0, order);
+  soa.narrow(1, 0, n).narrow(0, 0, 4).copy_(sorted.t());
+  soa[4].narrow(0, 0, n).copy_(
+      (sorted.select(1, 2) - sorted.select(1, 0)) *
+      (sorted.select(1, 3) - sorted.select(1, 1)));
+  return soa;
+}
+
 template <typename scalar_t>
 at::Tensor nms_cpu_kernel(
     const at::Tensor& dets,
@@ -16,58 +103,132 @@ at::Tensor nms_cpu_kernel(
   if (dets.numel() == 0)
     return at::empty({0}, dets.options().dtype(at::kLong));
 
-  auto x1_t = dets.select(1, 0).contiguous();
-  auto y1_t = dets.select(1, 1).contiguous();
-  auto x2_t = dets.select(1, 2).contiguous();
-  auto y2_t = dets.select(1, 3).contiguous();
-
-  at::Tensor areas_t = (x2_t - x1_t) * (y2_t - y1_t);
-
   auto order_t = std::get<1>(scores.sort(0, /* descending=*/true));
-
   auto ndets = dets.size(0);
-  at::Tensor suppressed_t = at::zeros({ndets}, dets.options().dtype(at::kByte));
-  at::Tensor keep_t = at::zeros({ndets}, dets.options().dtype(at::kLong));
+  auto soa_t = gather_soa<scalar_t>(dets, order_t);
 
-  auto suppressed = suppressed_t.data_ptr<uint8_t>();
+  at::Tensor keep_t = at::empty({ndets}, dets.options().dtype(at::kLong));
   auto keep = keep_t.data_ptr<int64_t>();
+  auto num_to_keep = nms_sorted_soa<scalar_t>(
+      soa_t[0].data_ptr<scalar_t>(),
+      soa_t[1].data_ptr<scalar_t>(),
+      soa_t[2].data_ptr<scalar_t>(),
+      soa_t[3].data_ptr<scalar_t>(),
+      soa_t[4].data_ptr<scalar_t>(),
+      ndets,
+      iou_threshold,
+      keep);
+
+  // positions in score order back to box indices
   auto order = order_t.data_ptr<int64_t>();
-  auto x1 = x1_t.data_ptr<scalar_t>();
-  auto y1 = y1_t.data_ptr<scalar_t>();
-  auto x2 = x2_t.data_ptr<scalar_t>();
-  auto y2 = y2_t.data_ptr<scalar_t>();
-  auto areas = areas_t.data_ptr<scalar_t>();
+  for (int64_t k = 0; k < num_to_keep; k++)
+    keep[k] = order[keep[k]];
+  return keep_t.narrow(/*dim=*/0, /*start=*/0, /*length=*/num_to_keep);
+}
 
-  int64_t num_to_keep = 0;
+// Per-class NMS. One score sort plus a stable counting sort by class puts the
+// boxes of each class into a contiguous, score-ordered bucket; buckets are
+// suppressed independently in parallel, and kept boxes are emitted by walking
+// the global score order once, so the result is sorted by decreasing score.
+template <typename scalar_t>
+at::Tensor batched_nms_cpu_kernel(
+    const at::Tensor& dets,
+    const at::Tensor& scores,
+    const at::Tensor& idxs,
+    const double iou_threshold) {
+  AT_ASSERTM(!dets.is_cuda(), "dets must be a CPU tensor");
+  AT_ASSERTM(!scores.is_cuda(), "scores must be a CPU tensor");
+  AT_ASSERTM(
+      dets.scalar_type() == scores.scalar_type(),
+      "dets should have the same type as scores");
 
-  for (int64_t _i = 0; _i < ndets; _i++) {
-    auto i = order[_i];
-    if (suppressed[i] == 1)
-      continue;
-    keep[num_to_keep++] = i;
-    auto ix1 = x1[i];
-    auto iy1 = y1[i];
-    auto ix2 = x2[i];
-    auto iy2 = y2[i];
-    auto iarea = areas[i];
-
-    for (int64_t _j = _i + 1; _j < ndets; _j++) {
-      auto j = order[_j];
-      if (suppressed[j] == 1)
-        continue;
-      auto xx1 = std::max(ix1, x1[j]);
-      auto yy1 = std::max(iy1, y1[j]);
-      auto xx2 = std::min(ix2, x2[j]);
-      auto yy2 = std::min(iy2, y2[j]);
+  if (dets.numel() == 0)
+    return at::empty({0}, dets.options().dtype(at::kLong));
 
-      auto w = std::max(static_cast<scalar_t>(0), xx2 - xx1);
-      auto h = std::max(static_cast<scalar_t>(0), yy2 - yy1);
-      auto inter = w * h;
-      auto ovr = inter / (iarea + areas[j] - inter);
-      if (ovr > iou_threshold)
-        suppressed[j] = 1;
+  auto ndets = dets.size(0);
+  auto order_t = std::get<1>(scores.sort(0, /* descending=*/true));
+  auto order = order_t.data_ptr<int64_t>();
+  auto labels_t = idxs.to(at::kLong).contiguous();
+  auto labels = labels_t.data_ptr<int64_t>();
+
+  int64_t min_label = labels[0], max_label = labels[0];
+  for (int64_t i = 1; i < ndets; i++) {
+    min_label = std::min(min_label, labels[i]);
+    max_label = std::max(max_label, labels[i]);
+  }
+  // bucket[i]: bucket of box i. Dense ranges of class ids are bucketed by
+  // offset; sparse ones are first compacted to the rank of each distinct id.
+  std::vector<int64_t> bucket(ndets);
+  auto num_buckets = max_label - min_label + 1;
+  if (num_buckets <= ndets) {
+    for (int64_t i = 0; i < ndets; i++)
+      bucket[i] = labels[i] - min_label;
+  } else {
+    std::vector<int64_t> ids(labels, labels + ndets);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (int64_t i = 0; i < ndets; i++)
+      bucket[i] =
+          std::lower_bound(ids.begin(), ids.end(), labels[i]) - ids.begin();
+    num_buckets = ids.size();
+  }
+
+  std::vector<int64_t> bucket_start(num_buckets + 1, 0);
+  for (int64_t i = 0; i < ndets; i++)
+    bucket_start[bucket[i] + 1]++;
+  for (int64_t b = 0; b < num_buckets; b++)
+    bucket_start[b + 1] += bucket_start[b];
+
+  // bucketed[pos]: box index; bucket_pos[k]: pos of k-th box in score order
+  at::Tensor bucketed_t = at::empty({ndets}, order_t.options());
+  auto bucketed = bucketed_t.data_ptr<int64_t>();
+  std::vector<int64_t> bucket_pos(ndets);
+  {
+    std::vector<int64_t> fill(bucket_start.begin(), bucket_start.end() - 1);
+    for (int64_t k = 0; k < ndets; k++) {
+      auto pos = fill[bucket[order[k]]]++;
+      bucketed[pos] = order[k];
+      bucket_pos[k] = pos;
     }
   }
+
+  auto soa_t = gather_soa<scalar_t>(dets, bucketed_t);
+  auto x1 = soa_t[0].data_ptr<scalar_t>();
+  auto y1 = soa_t[1].data_ptr<scalar_t>();
+  auto x2 = soa_t[2].data_ptr<scalar_t>();
+  auto y2 = soa_t[3].data_ptr<scalar_t>();
+  auto areas = soa_t[4].data_ptr<scalar_t>();
+
+  std::vector<uint8_t> kept(ndets, 0);
+  at::parallel_for(0, num_buckets, 1, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> keep;
+    for (int64_t b = begin; b < end; b++) {
+      auto start = bucket_start[b];
+      auto n = bucket_start[b + 1] - start;
+      if (n == 0)
+        continue;
+      keep.resize(n);
+      auto num_to_keep = nms_sorted_soa<scalar_t>(
+          x1 + start,
+          y1 + start,
+          x2 + start,
+          y2 + start,
+          areas + start,
+          n,
+          iou_threshold,
+          keep.data());
+      for (int64_t k = 0; k < num_to_keep; k++)
+        kept[start + keep[k]] = 1;
+    }
+  });
+
+  at::Tensor keep_t = at::empty({ndets}, dets.options().dtype(at::kLong));
+  auto keep = keep_t.data_ptr<int64_t>();
+  int64_t num_to_keep = 0;
+  for (int64_t k = 0; k < ndets; k++) {
+    if (kept[bucket_pos[k]])
+      keep[num_to_keep++] = order[k];
+  }
   return keep_t.narrow(/*dim=*/0, /*start=*/0, /*length=*/num_to_keep);
 }
 
@@ -102,4 +263,32 @@ at::Tensor nms_cpu(
   return result;
 }
 
+at::Tensor batched_nms_cpu(
+    const at::Tensor& dets,
+    const at::Tensor& scores,
+    const at::Tensor& idxs,
+    const double iou_threshold) {
+  TORCH_CHECK(
+      dets.dim() == 2, "boxes should be a 2d tensor, got ", dets.dim(), "D");
+  TORCH_CHECK(
+      dets.size(1) == 4,
+      "boxes should have 4 elements in dimension 1, got ",
+      dets.size(1));
+  TORCH_CHECK(
+      scores.dim() == 1 && idxs.dim() == 1,
+      "scores and idxs should be 1d tensors");
+  TORCH_CHECK(
+      dets.size(0) == scores.size(0) && dets.size(0) == idxs.size(0),
+      "boxes, scores and idxs should have same number of elements in ",
+      "dimension 0");
+
+  auto result = at::empty({0}, dets.options());
+
+  AT_DISPATCH_FLOATING_TYPES(dets.scalar_type(), "batched_nms", [&] {
+    result =
+        batched_nms_cpu_kernel<scalar_t>(dets, scores, idxs, iou_threshold);
+  });
+  return result;
+}
+
 } // namespace detectron2
@@ -1,4 +1,5 @@
 // Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved
+#include <ATen/Parallel.h>
 #include "../box_iou_rotated/box_iou_rotated_utils.h"
 #include "nms_rotated.h"
 
@@ -25,6 +26,8 @@ at::Tensor nms_rotated_cpu_kernel(
 
   auto order_t = std::get<1>(scores.sort(0, /* descending=*/true));
 
+  // boxes in score order, so that the inner loop walks memory linearly
+  auto sorted_t = dets.index_select(0, order_t).contiguous();
   auto ndets = dets.size(0);
   at::Tensor suppressed_t = at::zeros({ndets}, dets.options().dtype(at::kByte));
   at::Tensor keep_t = at::zeros({ndets}, dets.options().dtype(at::kLong));
@@ -32,29 +35,44 @@ at::Tensor nms_rotated_cpu_kernel(
   auto suppressed = suppressed_t.data_ptr<uint8_t>();
   auto keep = keep_t.data_ptr<int64_t>();
   auto order = order_t.data_ptr<int64_t>();
+  auto boxes = sorted_t.data_ptr<scalar_t>();
+
+  std::vector<scalar_t> radius(ndets);
+  for (int64_t i = 0; i < ndets; i++) {
+    radius[i] = rotated_box_radius<scalar_t>(boxes + i * 5);
+  }
+  // with a threshold of 0 even disjoint boxes suppress each other
+  bool prefilter = iou_threshold > 0;
 
   int64_t num_to_keep = 0;
 
-  for (int64_t _i = 0; _i < ndets; _i++) {
-    auto i = order[_i];
+  for (int64_t i = 0; i < ndets; i++) {
     if (suppressed[i] == 1) {
       continue;
     }
 
-    keep[num_to_keep++] = i;
+    keep[num_to_keep++] = order[i];
 
-    for (int64_t _j = _i + 1; _j < ndets; _j++) {
-      auto j = order[_j];
-      if (suppressed[j] == 1) {
-        continue;
-      }
+    auto box_i = boxes + i * 5;
+    // each j is written by one thread only, and the greedy order over i is kept
+    at::parallel_for(i + 1, ndets, 256, [&](int64_t begin, int64_t end) {
+      for (int64_t j = begin; j < end; j++) {
+        if (suppressed[j] == 1) {
+          continue;
+        }
+        auto box_j = boxes + j * 5;
+        if (prefilter &&
+            !rotated_boxes_may_overlap<scalar_t>(
+                box_i, radius[i], box_j, radius[j])) {
+          continue;
+        }
 
-      auto ovr = single_box_iou_rotated<scalar_t>(
-          dets[i].data_ptr<scalar_t>(), dets[j].data_ptr<scalar_t>());
-      if (ovr >= iou_threshold) {
-        suppressed[j] = 1;
+        auto ovr = single_box_iou_rotated<scalar_t>(box_i, box_j);
+        if (ovr >= iou_threshold) {
+          suppressed[j] = 1;
+        }
       }
-    }
+    });
   }
   return keep_t.narrow(/*dim=*/0, /*start=*/0, /*length=*/num_to_keep);
 }